@@ -22,10 +22,15 @@ static AllocPool poolPetit = {NULL, NULL, 0, 0};
 static size_t _taille_gros_bloc = 0;
 
 int prepareMemoire(size_t tailleImageEntree, size_t tailleImageSortie)
+{
+    return prepareMemoireN(tailleImageEntree, tailleImageSortie, ALLOC_N_GROS_BLOCS);
+}
+
+int prepareMemoireN(size_t tailleImageEntree, size_t tailleImageSortie, size_t nGrosBlocs)
 {
     size_t tailleGrosBloc = (tailleImageEntree > tailleImageSortie) ? tailleImageEntree : tailleImageSortie;
 
-    if (tailleGrosBloc == 0)
+    if (tailleGrosBloc == 0 || nGrosBlocs == 0)
         return -1;
 
     if (poolGros.pool != NULL)
@@ -47,7 +52,7 @@ int prepareMemoire(size_t tailleImageEntree, size_t tailleImageSortie)
         poolPetit.tailleBloc = 0;
     }
 
-    poolGros.nBlocs = ALLOC_N_GROS_BLOCS;
+    poolGros.nBlocs = nGrosBlocs;
     poolGros.tailleBloc = tailleGrosBloc;
     poolGros.pool = (unsigned char *)malloc(poolGros.nBlocs * poolGros.tailleBloc);
     poolGros.libre = (unsigned char *)malloc(poolGros.nBlocs);
@@ -96,13 +101,15 @@ void *tempsreel_malloc(size_t taille)
 
     if (pool != NULL)
     {
+        // Le drapeau libre est pris par échange atomique : deux fils d'exécution
+        // ne peuvent pas obtenir le même bloc
         for (size_t i = 0; i < pool->nBlocs; ++i)
         {
-            if (pool->libre[i])
-            {
-                pool->libre[i] = 0;
+            unsigned char attendu = 1;
+            if (pool->libre[i] &&
+                __atomic_compare_exchange_n(&pool->libre[i], &attendu, 0, 0,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
                 return pool->pool + i * pool->tailleBloc;
-            }
         }
         fprintf(stderr, "tempsreel_malloc: pool épuisé!\n");
     }
@@ -124,7 +131,7 @@ void tempsreel_free(void *ptr)
         {
             size_t index = (size_t)(p - debut) / poolGros.tailleBloc;
             if (index < poolGros.nBlocs)
-                poolGros.libre[index] = 1;
+                __atomic_store_n(&poolGros.libre[index], 1, __ATOMIC_RELEASE);
             return;
         }
     }
@@ -138,7 +145,7 @@ void tempsreel_free(void *ptr)
         {
             size_t index = (size_t)(p - debut) / poolPetit.tailleBloc;
             if (index < poolPetit.nBlocs)
-                poolPetit.libre[index] = 1;
+                __atomic_store_n(&poolPetit.libre[index], 1, __ATOMIC_RELEASE);
             return;
         }
     }
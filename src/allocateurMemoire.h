@@ -72,8 +72,14 @@ extern "C" {
 // problème (par exemple manque de mémoire) est survenu.
 int prepareMemoire(size_t tailleImageEntree, size_t tailleImageSortie);
 
+// Identique à prepareMemoire, mais avec nGrosBlocs "gros" blocs plutôt que
+// ALLOC_N_GROS_BLOCS (par exemple lorsque plusieurs fils d'exécution décodent
+// des images en même temps).
+int prepareMemoireN(size_t tailleImageEntree, size_t tailleImageSortie, size_t nGrosBlocs);
+
 // Ces deux fonctions doivent pouvoir s'utiliser exactement comme malloc() et free()
-// (dans la limite de la mémoire disponible, bien sûr)
+// (dans la limite de la mémoire disponible, bien sûr). Elles peuvent être appelées
+// par plusieurs fils d'exécution à la fois (mais pas pendant prepareMemoire).
 void* tempsreel_malloc(size_t taille);
 
 void tempsreel_free(void* ptr);
@@ -0,0 +1,410 @@
+# Banc d'essai du pipeline : execute chaque scenario de configs/ sans ecran
+# (compositeur -o null) sur des videos synthetiques produites par genererULV,
+# puis ecrit un rapport JSON (debit, temps CPU et percentiles par etape).
+#
+# Pour chaque scenario :
+#   - les videos NNNp/nom.ulv sont remplacees par des fichiers generes de
+#     NNN lignes en 16:9 (genererULV), crees une seule fois par execution;
+#   - les zones /memN deviennent /bancN (un pipeline deja lance n'est pas
+#     touche);
+#   - sans les droits root (ou avec --nort), les options -s et -d sont
+#     retirees : tout tourne en SCHED_OTHER, ce qui est indique dans le
+#     rapport;
+#   - les programmes sont lances dans l'ordre du script, chacun attendant
+#     ses zones d'entree, puis le pipeline tourne --rodage + --duree
+#     secondes. Seules les --duree dernieres secondes sont mesurees.
+#
+# Mesures, par etape :
+#   cpu_s, cpu_pct       temps CPU (utilisateur + systeme, tous les fils)
+#                        pendant la fenetre, lu dans /proc/<pid>/stat
+#   images, fps          images produites (entrees en attente d'ecriture;
+#                        compositeur : passes d'affichage), d'apres le
+#                        fichier profilage-*
+#   cpu_ms_par_image     cpu_s / images
+#   traitement_ms        temps passe en ETAT_TRAITEMENT pour chaque image
+#                        (p50, p90, p99, max)
+#   intervalle_ms        delai entre deux images produites (p50, p99, max)
+#   etats                fraction du temps passee dans chaque etat
+# et pour chaque entree du compositeur (d'apres -S, fenetres de 5 s) :
+#   fps, p50_ms (mediane des fenetres), p99_ms et p999_ms (pire fenetre),
+#   gigue_ms (moyenne), retards (somme).
+# Le profilage n'est ecrit sur disque qu'aux 4 secondes : la fin de la
+# fenetre est ramenee au dernier evenement enregistre.
+#
+# Avec --reference, le rapport est compare a un rapport precedent : une
+# baisse de fps ou une hausse de cpu_ms_par_image de plus de --tolerance %
+# est signalee et le code de retour vaut 1.
+#
+# Usage
+# python bancEssai.py --executables=build/ --sortie=banc.json
+# python bancEssai.py 01 06 --duree=10 --complexite=3
+# python bancEssai.py --executables=build/ --reference=banc-avant.json
+
+import argparse
+import datetime
+import json
+import os
+import platform
+import re
+import shlex
+import shutil
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+ETATS = {0: "indefini", 10: "initialisation", 20: "attente_lecture",
+         30: "traitement", 40: "attente_ecriture", 50: "pause", 60: "saut"}
+ETAT_TRAITEMENT = 30
+ETAT_ATTENTE_ECRITURE = 40
+DELAI_ZONES_S = 15.0
+TICS = os.sysconf("SC_CLK_TCK")
+
+RE_COMMANDE = re.compile(r"^\s*sudo\s+\./(\w+)\s+(.*?)\s*&\s*$")
+RE_ZONE = re.compile(r"^/mem(\d+)$")
+RE_VIDEO = re.compile(r"^(\d+)p/([^/]+\.ulv)$")
+
+
+class Etape:
+    def __init__(self, programme, args):
+        self.programme = programme
+        self.args = args
+        self.entrees = []
+        self.sortie = None
+        self.processus = None
+        self.cpu_debut = None
+        self.cpu_fin = None
+
+
+def percentile(valeurs, p):
+    # Rang le plus proche, sur une liste triee
+    if not valeurs:
+        return None
+    rang = max(1, -(-len(valeurs) * p // 100))
+    return valeurs[int(rang) - 1]
+
+
+def resume(valeurs, percentiles):
+    valeurs = sorted(valeurs)
+    r = {f"p{str(p).replace('.', '')}": arrondi(percentile(valeurs, p))
+         for p in percentiles}
+    r["max"] = arrondi(valeurs[-1]) if valeurs else None
+    return r
+
+
+def arrondi(v, n=3):
+    return None if v is None else round(v, n)
+
+
+def lire_scenario(chemin, nort, videos):
+    etapes = []
+    for ligne in chemin.read_text().splitlines():
+        m = RE_COMMANDE.match(ligne)
+        if not m:
+            continue
+        args = shlex.split(m.group(2))
+        etape = Etape(m.group(1), [])
+        i = 0
+        while i < len(args):
+            a = args[i]
+            if nort and a in ("-s", "-d"):
+                i += 2
+                continue
+            zone = RE_ZONE.match(a)
+            video = RE_VIDEO.match(a)
+            if zone:
+                a = f"/banc{zone.group(1)}"
+                etape.entrees.append(a)
+            elif video:
+                a = str(videos(int(video.group(1)), video.group(2)))
+            etape.args.append(a)
+            i += 1
+        # La derniere zone est la sortie, sauf pour le compositeur
+        if etape.programme != "compositeur" and etape.entrees:
+            etape.sortie = etape.entrees.pop()
+        else:
+            etape.args[:0] = ["-o", "null", "-S", "affichage.json"]
+        etapes.append(etape)
+    return etapes
+
+
+def cpu_processus(pid):
+    # utime + stime (champs 14 et 15), en secondes
+    try:
+        champs = Path(f"/proc/{pid}/stat").read_text().rpartition(")")[2].split()
+    except OSError:
+        return None
+    return (int(champs[11]) + int(champs[12])) / TICS
+
+
+def nettoyer_zones(etapes):
+    for etape in etapes:
+        for zone in etape.entrees + [etape.sortie]:
+            if zone is not None:
+                Path("/dev/shm" + zone).unlink(missing_ok=True)
+
+
+def arreter(etapes):
+    for etape in etapes:
+        if etape.processus and etape.processus.poll() is None:
+            etape.processus.send_signal(signal.SIGTERM)
+    for etape in etapes:
+        if etape.processus:
+            try:
+                etape.processus.wait(timeout=3)
+            except subprocess.TimeoutExpired:
+                etape.processus.kill()
+                etape.processus.wait()
+
+
+def executer(etapes, executables, dossier, rodage, duree):
+    nettoyer_zones(etapes)
+    for n, etape in enumerate(etapes):
+        limite = time.monotonic() + DELAI_ZONES_S
+        for zone in etape.entrees:
+            while not os.path.exists("/dev/shm" + zone):
+                if time.monotonic() > limite or any(
+                        e.processus.poll() is not None for e in etapes[:n]):
+                    return f"{zone} n'a pas ete creee"
+                time.sleep(0.05)
+        cmd = [str(executables / etape.programme)] + etape.args
+        journal = open(dossier / f"{n:02d}-{etape.programme}.log", "w")
+        etape.processus = subprocess.Popen(cmd, cwd=dossier, stdout=journal,
+                                           stderr=subprocess.STDOUT)
+        journal.close()
+
+    time.sleep(rodage)
+    debut = time.monotonic_ns()
+    for etape in etapes:
+        etape.cpu_debut = cpu_processus(etape.processus.pid)
+    time.sleep(duree)
+    fin = time.monotonic_ns()
+    for etape in etapes:
+        etape.cpu_fin = cpu_processus(etape.processus.pid)
+    morts = [e.programme for e in etapes if e.processus.poll() is not None]
+    return (debut, fin) if not morts else f"arret premature : {', '.join(morts)}"
+
+
+def lire_profilage(fichier):
+    evenements = []
+    for ligne in fichier.read_text().splitlines():
+        etat, _, temps = ligne.partition(",")
+        try:
+            evenements.append((int(etat), float(temps)))
+        except ValueError:
+            continue
+    return evenements
+
+
+def mesurer_etape(etape, dossier, debut, fin):
+    r = {"programme": etape.programme, "sortie": etape.sortie,
+         "pid": etape.processus.pid}
+    if etape.cpu_debut is not None and etape.cpu_fin is not None:
+        cpu = etape.cpu_fin - etape.cpu_debut
+        r["cpu_s"] = arrondi(cpu)
+        r["cpu_pct"] = arrondi(100.0 * cpu / ((fin - debut) / 1e9), 1)
+    fichier = dossier / f"profilage-{etape.programme}-{etape.processus.pid}.txt"
+    if not fichier.exists():
+        return r
+    evenements = lire_profilage(fichier)
+    if not evenements:
+        return r
+    fenetre_cpu = fin - debut
+    fin = min(fin, evenements[-1][1])
+    if fin <= debut:
+        return r
+
+    marqueur = (ETAT_TRAITEMENT if etape.programme == "compositeur"
+                else ETAT_ATTENTE_ECRITURE)
+    durees = {}
+    images, traitement, intervalles = [], [], []
+    en_cours = 0.0
+    for (etat, t0), (_, t1) in zip(evenements, evenements[1:]):
+        d0, d1 = max(t0, debut), min(t1, fin)
+        if d1 > d0:
+            durees[etat] = durees.get(etat, 0.0) + d1 - d0
+        if etat == marqueur:
+            if debut <= t0 <= fin:
+                if images:
+                    intervalles.append((t0 - images[-1]) / 1e6)
+                    traitement.append(en_cours / 1e6)
+                images.append(t0)
+            en_cours = 0.0
+        if etat == ETAT_TRAITEMENT:
+            en_cours += t1 - t0
+
+    fenetre = (fin - debut) / 1e9
+    r["images"] = len(images)
+    r["fps"] = arrondi(len(images) / fenetre, 2)
+    if "cpu_s" in r and images:
+        # Le temps CPU couvre toute la fenetre, le profilage peut s'arreter avant
+        images_cpu = len(images) / fenetre * (fenetre_cpu / 1e9)
+        r["cpu_ms_par_image"] = arrondi(1000.0 * r["cpu_s"] / images_cpu)
+    if etape.programme != "compositeur":
+        r["traitement_ms"] = resume(traitement, (50, 90, 99))
+    r["intervalle_ms"] = resume(intervalles, (50, 99))
+    total = sum(durees.values())
+    r["etats"] = {ETATS.get(e, str(e)): arrondi(d / total)
+                  for e, d in sorted(durees.items())}
+    return r
+
+
+def mesurer_affichage(dossier, rodage):
+    fichier = dossier / "affichage.json"
+    if not fichier.exists():
+        return []
+    fenetres = {}
+    for ligne in fichier.read_text().splitlines():
+        try:
+            f = json.loads(ligne)
+        except json.JSONDecodeError:
+            continue
+        if f["temps_s"] > rodage:
+            fenetres.setdefault(f["entree"], []).append(f)
+    resultats = []
+    for entree, fs in sorted(fenetres.items()):
+        duree = fs[-1]["temps_s"] - (fs[0]["temps_s"] - 5.0)
+        resultats.append({
+            "entree": entree,
+            "fps": arrondi(sum(f["images"] for f in fs) / duree, 2),
+            "p50_ms": arrondi(sorted(f["p50_ms"] for f in fs)[len(fs) // 2]),
+            "p99_ms": max(f["p99_ms"] for f in fs),
+            "p999_ms": max(f["p999_ms"] for f in fs),
+            "gigue_ms": arrondi(sum(f["gigue_ms"] for f in fs) / len(fs)),
+            "retards": sum(f["retards"] for f in fs),
+        })
+    return resultats
+
+
+def comparer(rapport, reference, tolerance):
+    regressions = []
+    anciens = {s["nom"]: s for s in reference.get("scenarios", [])}
+    for s in rapport["scenarios"]:
+        ancien = anciens.get(s["nom"])
+        if ancien is None or not s["ok"] or not ancien["ok"]:
+            continue
+        paires = list(zip(ancien["etapes"], s["etapes"])) + \
+            list(zip(ancien["affichage"], s["affichage"]))
+        for a, n in paires:
+            nom = " ".join(str(x) for x in (s["nom"], n.get("programme", "affichage"),
+                                            n.get("sortie") or n.get("entree")) if x)
+            if a.get("fps") and n.get("fps") is not None and \
+                    n["fps"] < a["fps"] * (1 - tolerance / 100):
+                regressions.append(f"{nom} : fps {a['fps']} -> {n['fps']}")
+            if a.get("cpu_ms_par_image") and n.get("cpu_ms_par_image") and \
+                    n["cpu_ms_par_image"] > a["cpu_ms_par_image"] * (1 + tolerance / 100):
+                regressions.append(f"{nom} : cpu_ms_par_image "
+                                   f"{a['cpu_ms_par_image']} -> {n['cpu_ms_par_image']}")
+    return regressions
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        prog="Banc d'essai du pipeline, Labo 3 SETR"
+    )
+    parser.add_argument("scenarios", nargs="*",
+                        help="Prefixes des scenarios a executer (ex. 01 06; defaut : tous)")
+    parser.add_argument("--executables", type=Path, default=Path("."),
+                        help="Dossier contenant les executables et genererULV (defaut : .)")
+    parser.add_argument("--configs", type=Path,
+                        default=Path(__file__).resolve().parent / "configs",
+                        help="Dossier des scenarios (defaut : configs/ a cote du script)")
+    parser.add_argument("--sortie", type=Path, default=Path("banc.json"),
+                        help="Rapport JSON (defaut : banc.json)")
+    parser.add_argument("--duree", type=float, default=20.0,
+                        help="Duree mesuree de chaque scenario, en secondes (defaut : 20)")
+    parser.add_argument("--rodage", type=float, default=3.0,
+                        help="Secondes ignorees au debut de chaque scenario (defaut : 3)")
+    parser.add_argument("--complexite", type=int, default=2,
+                        help="Complexite des videos generees, 0 a 3 (defaut : 2)")
+    parser.add_argument("--fps", type=int, default=30,
+                        help="Cadence des videos generees (defaut : 30)")
+    parser.add_argument("--images", type=int, default=150,
+                        help="Images par video generee, lue en boucle (defaut : 150)")
+    parser.add_argument("--nort", action="store_true",
+                        help="Retirer -s et -d meme avec les droits root")
+    parser.add_argument("--reference", type=Path,
+                        help="Rapport precedent auquel comparer celui-ci")
+    parser.add_argument("--tolerance", type=float, default=10.0,
+                        help="Ecart tolere avec --reference, en %% (defaut : 10)")
+    parser.add_argument("--conserver", action="store_true",
+                        help="Garder le dossier de travail (journaux, profilage)")
+    args = parser.parse_args()
+
+    executables = args.executables.resolve()
+    nort = args.nort or os.geteuid() != 0
+    travail = Path(tempfile.mkdtemp(prefix="banc-"))
+    generees = {}
+
+    def video(hauteur, nom):
+        # Une video synthetique par nom et par resolution
+        chemin = travail / "videos" / f"{hauteur}p" / nom
+        if chemin not in generees:
+            chemin.parent.mkdir(parents=True, exist_ok=True)
+            largeur = round(hauteur * 16 / 9)
+            subprocess.run([str(executables / "genererULV"), "-w", str(largeur),
+                            "-h", str(hauteur), "-f", str(args.fps),
+                            "-n", str(args.images), "-c", str(args.complexite),
+                            str(chemin)], check=True, stdout=subprocess.DEVNULL)
+            generees[chemin] = True
+        return chemin
+
+    scripts = sorted(p for p in args.configs.glob("*.bash")
+                     if not args.scenarios or any(p.name.startswith(s)
+                                                  for s in args.scenarios))
+    rapport = {
+        "date": datetime.datetime.now().isoformat(timespec="seconds"),
+        "machine": {"architecture": platform.machine(), "noyau": platform.release(),
+                    "cpus": os.cpu_count()},
+        "duree_s": args.duree, "rodage_s": args.rodage,
+        "videos": {"complexite": args.complexite, "fps": args.fps,
+                   "images": args.images},
+        "temps_reel": not nort,
+        "scenarios": [],
+    }
+
+    for script in scripts:
+        nom = script.stem
+        print(f"[banc] {nom}", file=sys.stderr)
+        dossier = travail / nom
+        dossier.mkdir()
+        etapes = lire_scenario(script, nort, video)
+        try:
+            resultat = executer(etapes, executables, dossier, args.rodage, args.duree)
+        finally:
+            arreter(etapes)
+            nettoyer_zones(etapes)
+        scenario = {"nom": nom, "ok": isinstance(resultat, tuple),
+                    "etapes": [], "affichage": []}
+        if scenario["ok"]:
+            debut, fin = resultat
+            scenario["etapes"] = [mesurer_etape(e, dossier, debut, fin) for e in etapes]
+            scenario["affichage"] = mesurer_affichage(dossier, args.rodage)
+            for e in scenario["etapes"]:
+                print(f"[banc]   {e['programme']:16s} {e.get('sortie') or '':8s}"
+                      f" {e.get('fps', 0):7.2f} fps  CPU {e.get('cpu_pct', 0):5.1f} %",
+                      file=sys.stderr)
+        else:
+            scenario["erreur"] = resultat
+            print(f"[banc]   ECHEC : {resultat}", file=sys.stderr)
+        rapport["scenarios"].append(scenario)
+
+    with open(args.sortie, "w") as f:
+        json.dump(rapport, f, indent=2)
+    print(f"[banc] Rapport ecrit dans {args.sortie}", file=sys.stderr)
+    if args.conserver:
+        print(f"[banc] Dossier de travail : {travail}", file=sys.stderr)
+    else:
+        shutil.rmtree(travail)
+
+    code = 0 if all(s["ok"] for s in rapport["scenarios"]) else 1
+    if args.reference:
+        with open(args.reference) as f:
+            regressions = comparer(rapport, json.load(f), args.tolerance)
+        for r in regressions:
+            print(f"[banc] REGRESSION {r}", file=sys.stderr)
+        if regressions:
+            code = 1
+    sys.exit(code)
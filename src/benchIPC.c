@@ -0,0 +1,725 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier implémentant le banc d'essai des zones mémoire partagées
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include "commMemoirePartagee.h"
+#include "histogramme.h"
+#include "mesures.h"
+#include "poolTrames.h"
+#include "utils.h"
+
+/******************************************************************************
+ * BANC D'ESSAI DES ZONES PARTAGÉES
+ * Mesure ce que coûte un passage d'image d'une étape à la suivante : attente
+ * et verrou de l'écrivain, copie de l'image dans la zone, signal, réveil du
+ * lecteur et copie de l'image hors de la zone. Chaque paire (un écrivain et
+ * les lecteurs de sa zone) utilise l'API de commMemoirePartagee.h comme les
+ * étapes du pipeline, en processus séparés (fork) ou en fils d'un même
+ * processus (pthread).
+ * Chaque combinaison d'ordonnancement (-o), d'exécution (-x), de mode de
+ * zone (-k, voir modes[]) et de taille d'image (-t) est mesurée en deux
+ * phases de -N images chacune :
+ *   latence  l'écrivain publie une image toutes les -i microsecondes; le
+ *            lecteur a donc le temps de s'endormir, comme dans le pipeline.
+ *            Sont affichés les percentiles (50, 99, 99,9 et max, en us) du
+ *            temps entre le début de attenteEcrivain et la fin de la copie
+ *            par le lecteur, et ceux du réveil seul (de signalEcrivain au
+ *            retour de attenteLecteur).
+ *   débit    l'écrivain publie sans pause. Sont affichées la cadence reçue
+ *            par le lecteur le plus lent de chaque paire (images/s, somme
+ *            des paires), le débit correspondant (Mo/s) et, pour les
+ *            politiques qui ne bloquent pas l'écrivain, la part des images
+ *            publiées jamais reçues. Avec ces politiques, l'écrivain attend
+ *            que les lecteurs aient ouvert la zone, puis publie jusqu'à ce
+ *            que chaque lecteur ait reçu ses -N images (au plus
+ *            DUREE_DEBIT_MAX_S secondes) et cède le coeur après chaque
+ *            image : sinon, sur un seul coeur, il publierait toute la phase
+ *            avant que le lecteur s'exécute. La cadence est alors celle des
+ *            images reçues sur la durée de publication de l'écrivain.
+ * Les -e premières images de chaque phase ne sont pas comptées (création de
+ * la zone, premiers accès aux pages).
+ * En mode POIGNEES, l'image est écrite dans une case d'un pool de trames et
+ * seule sa poignée passe par la zone (voir poolTrames.h); le lecteur la lit
+ * dans le pool, puis relâche la case.
+ * Un nouveau mode de synchronisation ou de mise en tampon se mesure en
+ * l'ajoutant au tableau modes[].
+ * Options communes (voir utils.h) : -c restreint les coeurs de tous les
+ * participants, -b règle l'attente active, -s mode équivaut à -o mode. -m,
+ * -p et -n sont remplacés par le mode mesuré.
+ * Options propres : -t tailles en octets (liste), -k modes (liste de noms),
+ * -o ordonnancements (liste, NORT,FIFO par défaut; ceux que le système
+ * refuse sont sautés), -x processus,fils, -N images par phase (500), -e
+ * images d'échauffement (50), -i intervalle en us (500), -P paires
+ * simultanées (1), -S fichier (CSV, ou JSON si le nom se termine par .json).
+ ******************************************************************************/
+#define IMAGES_DEFAUT 500
+#define ECHAUFFEMENT_DEFAUT 50
+#define INTERVALLE_DEFAUT_US 500
+#define PAIRES_MAX 8
+#define TAILLES_MAX 16
+#define ORDONNANCEMENTS_MAX 8
+#define NUMERO_FIN UINT64_MAX
+// Phase de débit sans attente : l'écrivain s'arrête au plus tard après cette
+// durée, même si un lecteur n'a pas reçu toutes ses images
+#define DUREE_DEBIT_MAX_S 10
+// Cases du pool en mode POIGNEES : une en écriture, une dans le canal, une en
+// lecture, plus une de réserve
+#define TRAMES_POIGNEES 4
+
+struct modeCanal {
+  const char *nom;
+  uint32_t modeSync;   // MODE_SYNC_*
+  uint32_t politique;  // POLITIQUE_*
+  uint32_t nbLecteurs; // Plus de 1 : diffusion
+  int poignees;        // Images passées par poignée (pool de trames)
+};
+
+static const struct modeCanal modes[] = {
+    {"PTHREAD", MODE_SYNC_PTHREAD, POLITIQUE_BLOQUANTE, 1, 0},
+    {"FUTEX", MODE_SYNC_FUTEX, POLITIQUE_BLOQUANTE, 1, 0},
+    {"FUTEX_PI", MODE_SYNC_FUTEX_PI, POLITIQUE_BLOQUANTE, 1, 0},
+    {"DERNIERE", MODE_SYNC_FUTEX, POLITIQUE_DERNIERE, 1, 0},
+    {"DIFFUSION2", MODE_SYNC_FUTEX, POLITIQUE_BLOQUANTE, 2, 0},
+    {"DIFFUSION2_DERNIERE", MODE_SYNC_FUTEX, POLITIQUE_DERNIERE, 2, 0},
+    {"POIGNEES", MODE_SYNC_FUTEX, POLITIQUE_BLOQUANTE, 1, 1},
+};
+
+// Petite image (64 octets : le coût fixe d'un passage), 160p en gris, 240p et
+// 480p en BGR
+static const size_t taillesDefaut[] = {64, 285 * 160, 427 * 240 * 3,
+                                       853 * 480 * 3};
+
+#define PHASE_LATENCE 0
+#define PHASE_DEBIT 1
+
+// Inscrit par l'écrivain au début de chaque image
+struct enteteTrame {
+  uint64_t numero; // NUMERO_FIN pour la dernière (fin de la phase)
+  uint64_t tDebut; // Avant attenteEcrivain
+  uint64_t tSignal; // Avant signalEcrivain
+};
+
+struct configuration {
+  const struct modeCanal *mode;
+  struct SchedParams ordonnancement;
+  size_t taille;
+  int phase;
+  unsigned int nbImages, echauffement;
+  uint64_t intervalleNs;
+};
+
+struct resultatLecteur {
+  struct histogramme latence, reveil; // En ns
+  uint64_t recues; // Images reçues après l'échauffement (lu par l'écrivain)
+  uint64_t tPremiere, tDerniere;
+  int pret; // Zone ouverte (lu par l'écrivain)
+};
+
+// Résultats d'une paire, dans une zone anonyme partagée avec les processus fils
+struct resultatsPaire {
+  struct resultatLecteur lecteurs[LECTEURS_MAX];
+  // Écrivain : images publiées après l'échauffement, de tDebut à tFin
+  uint64_t publiees, tDebut, tFin;
+  volatile int erreur;
+};
+
+struct participant {
+  const struct configuration *config;
+  struct resultatsPaire *resultats;
+  char nomZone[64];
+  char nomPool[POOL_NOM_MAX]; // Mode POIGNEES
+  int indice; // -1 pour l'écrivain, indice du lecteur sinon
+};
+
+static void attendreJusqua(uint64_t echeanceNs) {
+  struct timespec t = {.tv_sec = (time_t)(echeanceNs / 1000000000ULL),
+                       .tv_nsec = (long)(echeanceNs % 1000000000ULL)};
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL) == EINTR)
+    ;
+}
+
+// Démappe une zone ouverte par initMemoirePartagee* (la zone entière a la
+// taille du fichier)
+static void fermerZone(struct memPartage *zone) {
+  struct stat st;
+  if (fstat(zone->fd, &st) == 0)
+    munmap(zone->header, (size_t)st.st_size);
+  close(zone->fd);
+}
+
+// Vrai quand chaque lecteur a reçu les images attendues de la phase
+static int lecteursServis(const struct configuration *c,
+                          struct resultatsPaire *res) {
+  for (unsigned int j = 0; j < c->mode->nbLecteurs; j++)
+    if (__atomic_load_n(&res->lecteurs[j].recues, __ATOMIC_RELAXED) <
+        c->nbImages - c->echauffement)
+      return 0;
+  return 1;
+}
+
+// Attend que chaque lecteur ait ouvert la zone. En dormant : un écrivain
+// temps réel qui céderait seulement le coeur affamerait un lecteur qui n'a
+// pas encore appliqué son ordonnancement.
+static void attendreLecteurs(const struct configuration *c,
+                             struct resultatsPaire *res, uint64_t limite) {
+  for (unsigned int j = 0; j < c->mode->nbLecteurs; j++)
+    while (!__atomic_load_n(&res->lecteurs[j].pret, __ATOMIC_ACQUIRE) &&
+           !res->erreur && maintenantNs() < limite)
+      attendreJusqua(maintenantNs() + 100000);
+}
+
+static void ecrivain(const struct participant *p) {
+  const struct configuration *c = p->config;
+  appliquerOrdonnancement(&c->ordonnancement, "benchIPC");
+
+  unsigned char *source = (unsigned char *)malloc(c->taille);
+  if (source == NULL) {
+    fprintf(stderr, "[benchIPC] Erreur d'allocation\n");
+    p->resultats->erreur = 1;
+    return;
+  }
+  memset(source, 0xA5, c->taille);
+
+  struct videoInfos infos = {.largeur = (uint32_t)c->taille,
+                             .hauteur = 1,
+                             .canaux = 1,
+                             .fps = 30,
+                             .format = FORMAT_GRAY8};
+  struct memPartage zone;
+  struct poolTrames pool;
+  struct canalPoignees canal;
+  int erreur = c->mode->poignees
+                   ? (initPoolTramesCreateur(p->nomPool, &pool, c->taille,
+                                             TRAMES_POIGNEES) != 0 ||
+                      initCanalPoigneesEcrivain(p->nomZone, &canal, &infos,
+                                                &pool) != 0)
+                   : (initMemoirePartageeEcrivainTaille(p->nomZone, &zone,
+                                                        &infos,
+                                                        c->taille) != 0);
+  if (erreur) {
+    p->resultats->erreur = 1;
+    free(source);
+    return;
+  }
+
+  // Politique qui ne bloque pas l'écrivain, phase de débit : voir l'en-tête
+  const int sansAttente =
+      c->phase == PHASE_DEBIT && c->mode->politique == POLITIQUE_DERNIERE;
+  struct resultatsPaire *res = p->resultats;
+  uint64_t prochaine = maintenantNs();
+  const uint64_t limite = prochaine + DUREE_DEBIT_MAX_S * 1000000000ULL;
+  if (sansAttente)
+    attendreLecteurs(c, res, limite);
+  int fin = 0;
+  for (uint64_t k = 0; !fin; k++) {
+    if (c->phase == PHASE_LATENCE) {
+      prochaine += c->intervalleNs;
+      attendreJusqua(prochaine);
+    }
+    if (sansAttente)
+      fin = lecteursServis(c, res) || maintenantNs() >= limite;
+    else
+      fin = (k == c->nbImages);
+    struct enteteTrame e;
+    e.numero = fin ? NUMERO_FIN : k;
+    e.tDebut = maintenantNs();
+    unsigned char *image;
+    int indice = POOL_TRAME_INVALIDE;
+    if (c->mode->poignees) {
+      // Le lecteur relâche sa case après l'avoir lue
+      while ((indice = acquerirTrame(&pool)) == POOL_TRAME_INVALIDE)
+        sched_yield();
+      image = donneesTrame(&pool, indice);
+    } else {
+      attenteEcrivain(&zone);
+      image = zone.data;
+    }
+    memcpy(image, source, c->taille);
+    e.tSignal = maintenantNs();
+    memcpy(image, &e, sizeof(e));
+    if (c->mode->poignees)
+      envoyerPoignee(&canal, indice);
+    else
+      signalEcrivain(&zone);
+
+    if (fin || k < c->echauffement)
+      continue;
+    if (res->publiees++ == 0)
+      res->tDebut = e.tDebut;
+    res->tFin = maintenantNs();
+    if (sansAttente)
+      sched_yield();
+  }
+
+  if (c->mode->poignees) {
+    fermerZone(&canal.zone);
+    fermerPoolTrames(&pool);
+  } else {
+    fermerZone(&zone);
+  }
+  free(source);
+}
+
+static void lecteur(const struct participant *p) {
+  const struct configuration *c = p->config;
+  struct resultatLecteur *r = &p->resultats->lecteurs[p->indice];
+  appliquerOrdonnancement(&c->ordonnancement, "benchIPC");
+
+  unsigned char *destination = (unsigned char *)malloc(c->taille);
+  if (destination == NULL) {
+    fprintf(stderr, "[benchIPC] Erreur d'allocation\n");
+    p->resultats->erreur = 1;
+    return;
+  }
+  memset(destination, 0, c->taille);
+
+  struct memPartage zone;
+  struct poolTrames pool;
+  struct canalPoignees canal;
+  int erreur = c->mode->poignees
+                   ? initCanalPoigneesLecteur(p->nomZone, &canal, &pool)
+                   : initMemoirePartageeLecteur(p->nomZone, &zone);
+  if (erreur != 0) {
+    p->resultats->erreur = 1;
+    free(destination);
+    return;
+  }
+  __atomic_store_n(&r->pret, 1, __ATOMIC_RELEASE);
+
+  while (1) {
+    const unsigned char *image;
+    int indice = POOL_TRAME_INVALIDE;
+    if (c->mode->poignees) {
+      indice = recevoirPoignee(&canal);
+      if (indice == POOL_TRAME_INVALIDE) {
+        p->resultats->erreur = 1;
+        break;
+      }
+      image = donneesTrame(&pool, indice);
+    } else {
+      attenteLecteur(&zone);
+      image = zone.data;
+    }
+    uint64_t tReveil = maintenantNs();
+    struct enteteTrame e;
+    memcpy(&e, image, sizeof(e));
+    memcpy(destination, image, c->taille);
+    uint64_t tFin = maintenantNs();
+    if (c->mode->poignees)
+      relacherTrame(&pool, indice);
+    else
+      signalLecteur(&zone);
+
+    if (e.numero == NUMERO_FIN)
+      break;
+    if (e.numero < c->echauffement)
+      continue;
+    if (r->recues == 0)
+      r->tPremiere = tFin;
+    __atomic_store_n(&r->recues, r->recues + 1, __ATOMIC_RELAXED);
+    r->tDerniere = tFin;
+    histoAjouter(&r->latence, tFin - e.tDebut);
+    histoAjouter(&r->reveil, tReveil - e.tSignal);
+  }
+
+  if (c->mode->poignees) {
+    fermerZone(&canal.zone);
+    fermerPoolTrames(&pool);
+  } else {
+    fermerZone(&zone);
+  }
+  free(destination);
+}
+
+static void executerParticipant(const struct participant *p) {
+  if (p->indice < 0)
+    ecrivain(p);
+  else
+    lecteur(p);
+}
+
+static void *filParticipant(void *arg) {
+  executerParticipant((const struct participant *)arg);
+  return NULL;
+}
+
+// Lance nbPaires paires (processus ou fils) et attend qu'elles aient terminé.
+// Retourne 0 en cas de succès, -1 si un participant n'a pu être lancé ou a
+// échoué.
+static int executerPhase(const struct configuration *c, int fils,
+                         unsigned int nbPaires,
+                         struct resultatsPaire *resultats) {
+  struct participant participants[PAIRES_MAX * (LECTEURS_MAX + 1)];
+  pid_t pids[PAIRES_MAX * (LECTEURS_MAX + 1)];
+  pthread_t filsLances[PAIRES_MAX * (LECTEURS_MAX + 1)];
+  unsigned int n = 0;
+  int erreur = 0;
+
+  memset(resultats, 0, nbPaires * sizeof(struct resultatsPaire));
+  for (unsigned int i = 0; i < nbPaires; i++) {
+    char nomZone[64], nomPool[POOL_NOM_MAX];
+    snprintf(nomZone, sizeof(nomZone), "/benchIPC-%d-%u", (int)getpid(), i);
+    snprintf(nomPool, sizeof(nomPool), "/benchIPC-pool-%d-%u", (int)getpid(),
+             i);
+    shm_unlink(nomZone); // Reste d'une exécution interrompue
+    shm_unlink(nomPool);
+    for (int indice = -1; indice < (int)c->mode->nbLecteurs; indice++) {
+      participants[n].config = c;
+      participants[n].resultats = &resultats[i];
+      participants[n].indice = indice;
+      strcpy(participants[n].nomZone, nomZone);
+      strcpy(participants[n].nomPool, nomPool);
+      n++;
+    }
+  }
+
+  unsigned int lances = 0;
+  for (; lances < n; lances++) {
+    if (fils) {
+      if (pthread_create(&filsLances[lances], NULL, filParticipant,
+                         &participants[lances]) != 0) {
+        fprintf(stderr, "[benchIPC] Erreur pthread_create\n");
+        break;
+      }
+    } else {
+      pids[lances] = fork();
+      if (pids[lances] == 0) {
+        executerParticipant(&participants[lances]);
+        _exit(0);
+      }
+      if (pids[lances] < 0) {
+        perror("[benchIPC] fork");
+        break;
+      }
+    }
+  }
+  // Un participant manquant bloquerait les autres indéfiniment
+  if (lances < n) {
+    for (unsigned int i = 0; i < lances && !fils; i++)
+      kill(pids[i], SIGKILL);
+    if (fils)
+      exit(EXIT_FAILURE);
+    erreur = 1;
+  }
+  for (unsigned int i = 0; i < lances; i++) {
+    if (fils)
+      pthread_join(filsLances[i], NULL);
+    else
+      waitpid(pids[i], NULL, 0);
+  }
+
+  for (unsigned int i = 0; i < nbPaires; i++) {
+    shm_unlink(participants[i * (c->mode->nbLecteurs + 1)].nomZone);
+    shm_unlink(participants[i * (c->mode->nbLecteurs + 1)].nomPool);
+    erreur = erreur || resultats[i].erreur;
+  }
+  return erreur ? -1 : 0;
+}
+
+// Vérifie (dans un processus jetable) que le système accepte l'ordonnancement
+static int ordonnancementPermis(const struct SchedParams *params) {
+  if (params->modeOrdonnanceur == ORDONNANCEMENT_NORT &&
+      params->masqueCpu == 0)
+    return 1;
+  pid_t pid = fork();
+  if (pid == 0)
+    _exit(appliquerOrdonnancement(params, "benchIPC") == 0 ? 0 : 1);
+  int statut = 0;
+  if (pid < 0 || waitpid(pid, &statut, 0) < 0)
+    return 0;
+  return WIFEXITED(statut) && WEXITSTATUS(statut) == 0;
+}
+
+// Vrai si nom fait partie de la liste (noms séparés par des virgules; NULL
+// pour tous)
+static int dansListe(const char *liste, const char *nom) {
+  if (liste == NULL)
+    return 1;
+  size_t n = strlen(nom);
+  for (const char *p = liste; *p;) {
+    const char *fin = strchr(p, ',');
+    size_t l = (fin != NULL) ? (size_t)(fin - p) : strlen(p);
+    if (l == n && strncmp(p, nom, n) == 0)
+      return 1;
+    p += l + (fin != NULL);
+  }
+  return 0;
+}
+
+struct statistiques {
+  struct histogramme latence, reveil;
+  double imagesSec, perduesPct;
+};
+
+static void calculerStatistiques(const struct configuration *c,
+                                 const struct resultatsPaire *latence,
+                                 const struct resultatsPaire *debit,
+                                 unsigned int nbPaires,
+                                 struct statistiques *s) {
+  const unsigned int nbLecteurs = c->mode->nbLecteurs;
+  const double attendues = (double)(c->nbImages - c->echauffement);
+  double perdues = 0.0;
+  histoReinitialiser(&s->latence);
+  histoReinitialiser(&s->reveil);
+  s->imagesSec = 0.0;
+  for (unsigned int i = 0; i < nbPaires; i++) {
+    double cadenceMin = -1.0;
+    for (unsigned int j = 0; j < nbLecteurs; j++) {
+      const struct resultatLecteur *rl = &latence[i].lecteurs[j];
+      const struct resultatLecteur *rd = &debit[i].lecteurs[j];
+      histoFusionner(&s->latence, &rl->latence);
+      histoFusionner(&s->reveil, &rl->reveil);
+      double cadence, perdue;
+      if (c->mode->politique == POLITIQUE_DERNIERE) {
+        // Images reçues sur la durée de publication, rapportées aux publiées
+        cadence = (debit[i].tFin > debit[i].tDebut)
+                      ? (double)rd->recues * 1e9 /
+                            (double)(debit[i].tFin - debit[i].tDebut)
+                      : 0.0;
+        perdue = (debit[i].publiees > 0)
+                     ? 1.0 - (double)rd->recues / (double)debit[i].publiees
+                     : 0.0;
+      } else {
+        cadence = (rd->recues > 1 && rd->tDerniere > rd->tPremiere)
+                      ? (double)(rd->recues - 1) * 1e9 /
+                            (double)(rd->tDerniere - rd->tPremiere)
+                      : 0.0;
+        perdue = (attendues > 0.0) ? 1.0 - (double)rd->recues / attendues : 0.0;
+      }
+      if (cadenceMin < 0.0 || cadence < cadenceMin)
+        cadenceMin = cadence;
+      perdues += perdue;
+    }
+    s->imagesSec += cadenceMin;
+  }
+  s->perduesPct = 100.0 * perdues / (nbPaires * nbLecteurs);
+  if (s->perduesPct < 0.0)
+    s->perduesPct = 0.0;
+}
+
+static const char *const colonnesSortie[] = {
+    "execution",      "mode",           "ordonnancement",  "taille",
+    "paires",         "latence_p50_us", "latence_p99_us",  "latence_p999_us",
+    "latence_max_us", "reveil_p50_us",  "reveil_p99_us",   "images_s",
+    "mo_s",           "perdues_pct"};
+
+static void ecrireResultat(struct sortieMesures *sortie, const char *execution,
+                           const char *ordonnancement,
+                           const struct configuration *c,
+                           unsigned int nbPaires,
+                           const struct statistiques *s) {
+  const double l50 = histoPercentile(&s->latence, 50.0) / 1000.0;
+  const double l99 = histoPercentile(&s->latence, 99.0) / 1000.0;
+  const double l999 = histoPercentile(&s->latence, 99.9) / 1000.0;
+  const double lmax = s->latence.max / 1000.0;
+  const double r50 = histoPercentile(&s->reveil, 50.0) / 1000.0;
+  const double r99 = histoPercentile(&s->reveil, 99.0) / 1000.0;
+  const double moSec = s->imagesSec * (double)c->taille / 1e6;
+  printf("%-9s %-19s %-8s %9zu %8.1f %8.1f %8.1f %8.1f %7.1f %7.1f %9.0f "
+         "%8.1f %6.1f\n",
+         execution, c->mode->nom, ordonnancement, c->taille, l50, l99, l999,
+         lmax, r50, r99, s->imagesSec, moSec, s->perduesPct);
+  mesureTexte(sortie, execution);
+  mesureTexte(sortie, c->mode->nom);
+  mesureTexte(sortie, ordonnancement);
+  mesureNombre(sortie, "%zu", c->taille);
+  mesureNombre(sortie, "%u", nbPaires);
+  mesureNombre(sortie, "%.2f", l50);
+  mesureNombre(sortie, "%.2f", l99);
+  mesureNombre(sortie, "%.2f", l999);
+  mesureNombre(sortie, "%.2f", lmax);
+  mesureNombre(sortie, "%.2f", r50);
+  mesureNombre(sortie, "%.2f", r99);
+  mesureNombre(sortie, "%.1f", s->imagesSec);
+  mesureNombre(sortie, "%.2f", moSec);
+  mesureNombre(sortie, "%.2f", s->perduesPct);
+  finLigneMesures(sortie);
+}
+
+int main(int argc, char *argv[]) {
+  setbuf(stdout, NULL);
+
+  struct SchedParams params = {
+      .modeOrdonnanceur = ORDONNANCEMENT_NORT,
+      .runtime = 0,
+      .deadline = 0,
+      .period = 0,
+  };
+  unsigned int nbImages = IMAGES_DEFAUT, echauffement = ECHAUFFEMENT_DEFAUT;
+  unsigned int intervalleUs = INTERVALLE_DEFAUT_US, nbPaires = 1;
+  const char *listeModes = NULL, *listeExecutions = "processus,fils";
+  const char *listeTailles = NULL, *nomSortie = NULL;
+  char listeOrdonnancements[256] = "NORT,FIFO";
+
+  int c;
+  opterr = 0;
+  while ((c = getopt(argc, argv, OPTIONS_COMMUNES "t:k:o:x:N:e:i:P:S:")) !=
+         -1) {
+    switch (c) {
+    case 't':
+      listeTailles = optarg;
+      break;
+    case 'k':
+      listeModes = optarg;
+      break;
+    case 's':
+    case 'o':
+      snprintf(listeOrdonnancements, sizeof(listeOrdonnancements), "%s",
+               optarg);
+      break;
+    case 'x':
+      listeExecutions = optarg;
+      break;
+    case 'N':
+      nbImages = (unsigned int)atoi(optarg);
+      break;
+    case 'e':
+      echauffement = (unsigned int)atoi(optarg);
+      break;
+    case 'i':
+      intervalleUs = (unsigned int)atoi(optarg);
+      break;
+    case 'P':
+      nbPaires = (unsigned int)atoi(optarg);
+      break;
+    case 'S':
+      nomSortie = optarg;
+      break;
+    default:
+      parseOptionCommune(c, optarg, &params);
+      break;
+    }
+  }
+
+  size_t tailles[TAILLES_MAX];
+  size_t nbTailles = 0;
+  if (listeTailles == NULL) {
+    nbTailles = sizeof(taillesDefaut) / sizeof(taillesDefaut[0]);
+    memcpy(tailles, taillesDefaut, sizeof(taillesDefaut));
+  } else {
+    const char *p = listeTailles;
+    while (nbTailles < TAILLES_MAX) {
+      char *fin;
+      tailles[nbTailles++] = (size_t)strtoull(p, &fin, 10);
+      if (*fin != ',')
+        break;
+      p = fin + 1;
+    }
+  }
+  int tailleValide = (nbTailles > 0);
+  for (size_t i = 0; i < nbTailles; i++)
+    tailleValide = tailleValide && tailles[i] >= sizeof(struct enteteTrame) &&
+                   tailles[i] <= UINT32_MAX;
+
+  if (nbImages <= echauffement + 1 || nbPaires == 0 ||
+      nbPaires > PAIRES_MAX || !tailleValide) {
+    fprintf(stderr,
+            "Usage: %s [options] [-t tailles] [-k modes] [-o ordonnancements] "
+            "[-x processus,fils] [-N images] [-e echauffement] "
+            "[-i intervalle_us] [-P paires 1-%d] [-S fichier]\n"
+            "(tailles d'au moins %zu octets; au moins deux images apres "
+            "l'echauffement)\n",
+            argv[0], PAIRES_MAX, sizeof(struct enteteTrame));
+    return -1;
+  }
+
+  struct SchedParams ordonnancements[ORDONNANCEMENTS_MAX];
+  char nomsOrdonnancements[ORDONNANCEMENTS_MAX][32];
+  size_t nbOrdonnancements = 0;
+  char *reste = NULL;
+  for (char *nom = strtok_r(listeOrdonnancements, ",", &reste);
+       nom != NULL && nbOrdonnancements < ORDONNANCEMENTS_MAX;
+       nom = strtok_r(NULL, ",", &reste)) {
+    struct SchedParams o = params;
+    if (parseSchedOption(nom, &o) != 0)
+      continue;
+    if (!ordonnancementPermis(&o)) {
+      printf("[benchIPC] Ordonnancement %s refuse par le systeme : saute\n",
+             nom);
+      continue;
+    }
+    ordonnancements[nbOrdonnancements] = o;
+    snprintf(nomsOrdonnancements[nbOrdonnancements], 32, "%s", nom);
+    nbOrdonnancements++;
+  }
+
+  struct resultatsPaire *resultats =
+      mmap(NULL, 2 * PAIRES_MAX * sizeof(struct resultatsPaire),
+           PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (resultats == MAP_FAILED) {
+    perror("[benchIPC] mmap");
+    return -1;
+  }
+
+  struct sortieMesures sortie;
+  if (ouvrirSortieMesures(&sortie, nomSortie, colonnesSortie,
+                          (int)(sizeof(colonnesSortie) /
+                                sizeof(colonnesSortie[0])),
+                          "benchIPC") != 0)
+    return -1;
+
+  printf("[benchIPC] %u images par phase (%u d'echauffement), intervalle %u "
+         "us, %u paire(s), attente active max %u ns, %ld coeur(s)\n",
+         nbImages, echauffement, intervalleUs, nbPaires,
+         optionsCanalDefaut.attenteActiveMaxNs, sysconf(_SC_NPROCESSORS_ONLN));
+  printf("%-9s %-19s %-8s %9s %8s %8s %8s %8s %7s %7s %9s %8s %6s\n",
+         "execution", "mode", "ordo", "octets", "lat p50", "p99", "p99.9",
+         "max", "rev p50", "p99", "images/s", "Mo/s", "perdu%");
+
+  static const char *executions[] = {"processus", "fils"};
+  int erreurs = 0;
+  for (size_t io = 0; io < nbOrdonnancements; io++) {
+    for (int fils = 0; fils < 2; fils++) {
+      if (!dansListe(listeExecutions, executions[fils]))
+        continue;
+      for (size_t im = 0; im < sizeof(modes) / sizeof(modes[0]); im++) {
+        if (!dansListe(listeModes, modes[im].nom))
+          continue;
+        // Lu par initMemoirePartageeEcrivainTaille (hérité par les processus fils)
+        optionsCanalDefaut.modeSync = modes[im].modeSync;
+        optionsCanalDefaut.politique = modes[im].politique;
+        optionsCanalDefaut.nbLecteurs = modes[im].nbLecteurs;
+        for (size_t it = 0; it < nbTailles; it++) {
+          struct configuration cfg = {
+              .mode = &modes[im],
+              .ordonnancement = ordonnancements[io],
+              .taille = tailles[it],
+              .nbImages = nbImages,
+              .echauffement = echauffement,
+              .intervalleNs = (uint64_t)intervalleUs * 1000ULL,
+          };
+          cfg.phase = PHASE_LATENCE;
+          if (executerPhase(&cfg, fils, nbPaires, resultats) != 0) {
+            erreurs++;
+            continue;
+          }
+          cfg.phase = PHASE_DEBIT;
+          if (executerPhase(&cfg, fils, nbPaires, resultats + PAIRES_MAX) !=
+              0) {
+            erreurs++;
+            continue;
+          }
+          struct statistiques s;
+          calculerStatistiques(&cfg, resultats, resultats + PAIRES_MAX,
+                               nbPaires, &s);
+          ecrireResultat(&sortie, executions[fils], nomsOrdonnancements[io],
+                         &cfg, nbPaires, &s);
+        }
+      }
+    }
+  }
+
+  fermerSortieMesures(&sortie);
+  munmap(resultats, 2 * PAIRES_MAX * sizeof(struct resultatsPaire));
+  return (erreurs > 0) ? 1 : 0;
+}
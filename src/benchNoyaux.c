@@ -0,0 +1,516 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier implémentant le banc d'essai des noyaux de traitement d'images
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+
+#include "allocateurMemoire.h"
+#include "mesures.h"
+#include "utils.h"
+
+/******************************************************************************
+ * BANC D'ESSAI DES NOYAUX
+ * Mesure chaque noyau de utils.c seul, sur une grille de cas : résolutions
+ * 160p, 240p et 480p (16:9), 1 ou 3 canaux, et les paramètres utilisés par le
+ * pipeline (filtres 3x3 et 5x5 de sigma 5, redimensionnement de moitié).
+ * Pour chaque cas, chaque variante est exécutée -e fois à blanc
+ * (échauffement : caches, fréquence du processeur), puis -r fois en mesurant
+ * le temps (CLOCK_MONOTONIC) et, si le noyau le permet, les cycles
+ * (perf_event_open, espace utilisateur seulement). Sont affichés :
+ *   ns/px     médiane, en ns par pixel produit
+ *   cv%       coefficient de variation des mesures (écart-type / moyenne)
+ *   min       meilleure mesure, en ns par pixel
+ *   o/cycle   octets lus et écrits (images d'entrée et de sortie) par cycle,
+ *             sur la médiane; « n/d » sans compteur de cycles
+ *   accel     accélération par rapport à la référence
+ *   ecart     plus grande différence avec la sortie de la référence
+ * La première variante de chaque noyau est la fonction de utils.c (la
+ * référence); les autres sont des implémentations candidates. Une variante
+ * dont l'écart dépasse sa tolérance est marquée ECHEC et le code de retour
+ * vaut 1 : une optimisation n'est acceptée que si elle est plus rapide et
+ * correcte. Pour essayer une nouvelle implémentation, il suffit de l'ajouter
+ * au tableau noyaux[].
+ * Le programme accepte les options communes (voir utils.h) : -c fixe le
+ * coeur (par défaut, celui sur lequel le programme démarre) et -s FIFO:prio
+ * évite d'être interrompu par les autres processus.
+ * Options propres : -r mesures (30), -e échauffement (3), -k noyau (sous-
+ * chaîne du nom, pour n'en mesurer qu'un), -S fichier (CSV, ou JSON si le
+ * nom se termine par .json).
+ ******************************************************************************/
+#define MAX_VARIANTES 4
+#define MESURES_DEFAUT 30
+#define ECHAUFFEMENT_DEFAUT 3
+
+struct casNoyau {
+  unsigned int hauteur, largeur, canaux; // Image d'entrée
+  unsigned int hauteurSortie, largeurSortie;
+  unsigned int tailleNoyau;
+  float sigma;
+  ResizeGrid grille;
+};
+
+typedef void (*fonctionNoyau)(const struct casNoyau *cas,
+                              const unsigned char *entree,
+                              unsigned char *sortie);
+
+struct variante {
+  const char *nom;
+  fonctionNoyau fonction;
+  int tolerance; // Plus grande différence acceptée avec la référence
+};
+
+#define GRILLE_AUCUNE 0
+#define GRILLE_PLUS_PROCHE 1
+#define GRILLE_BILINEAIRE 2
+
+struct noyau {
+  const char *nom;
+  int grille;       // GRILLE_* : le noyau redimensionne l'image de moitié
+  int filtre;       // Mesuré avec des noyaux 3x3 et 5x5
+  int couleurSeule; // Entrée à 3 canaux seulement
+  struct variante variantes[MAX_VARIANTES];
+};
+
+/* Références (utils.c) */
+
+static void refPasseBas(const struct casNoyau *c, const unsigned char *e,
+                        unsigned char *s) {
+  lowpassFilter(c->hauteur, c->largeur, e, s, c->tailleNoyau, c->sigma,
+                c->canaux);
+}
+
+static void refPasseHaut(const struct casNoyau *c, const unsigned char *e,
+                         unsigned char *s) {
+  highpassFilter(c->hauteur, c->largeur, e, s, c->tailleNoyau, c->sigma,
+                 c->canaux);
+}
+
+static void refPlusProche(const struct casNoyau *c, const unsigned char *e,
+                          unsigned char *s) {
+  resizeNearestNeighbor(e, c->hauteur, c->largeur, s, c->hauteurSortie,
+                        c->largeurSortie, c->grille, c->canaux);
+}
+
+static void refBilineaire(const struct casNoyau *c, const unsigned char *e,
+                          unsigned char *s) {
+  resizeBilinear(e, c->hauteur, c->largeur, s, c->hauteurSortie,
+                 c->largeurSortie, c->grille, c->canaux);
+}
+
+static void refGris(const struct casNoyau *c, const unsigned char *e,
+                    unsigned char *s) {
+  convertToGray(e, c->hauteur, c->largeur, c->canaux, s);
+}
+
+/* Variantes candidates */
+
+static inline unsigned int borner(int v, unsigned int n) {
+  return (v < 0) ? 0 : (((unsigned int)v >= n) ? n - 1 : (unsigned int)v);
+}
+
+// Le noyau gaussien 2D est le produit de deux noyaux 1D : deux passes de k
+// opérations par pixel plutôt que k * k, directement sur les pixels entrelacés
+// (sans _permuteRGB). L'ordre des additions diffère : tolérance de 1.
+static void passeBasSeparable(const struct casNoyau *c,
+                              const unsigned char *e, unsigned char *s) {
+  const unsigned int w = c->largeur, h = c->hauteur, n = c->canaux;
+  const int k2 = (int)c->tailleNoyau / 2;
+  float g[32], somme = 0.0f;
+  for (int i = -k2; i <= k2; i++) {
+    g[i + k2] = expf(-(float)(i * i) / (2.0f * c->sigma * c->sigma));
+    somme += g[i + k2];
+  }
+  for (int i = -k2; i <= k2; i++)
+    g[i + k2] /= somme;
+
+  float *tmp = (float *)tempsreel_malloc((size_t)w * h * n * sizeof(float));
+  if (tmp == NULL) {
+    fprintf(stderr, "[passeBasSeparable] Erreur d'allocation memoire\n");
+    exit(EXIT_FAILURE);
+  }
+  for (unsigned int y = 0; y < h; y++) {
+    const unsigned char *ligne = e + (size_t)y * w * n;
+    for (unsigned int x = 0; x < w; x++) {
+      for (unsigned int k = 0; k < n; k++) {
+        float acc = 0.0f;
+        for (int j = -k2; j <= k2; j++)
+          acc += g[j + k2] * ligne[borner((int)x + j, w) * n + k];
+        tmp[((size_t)y * w + x) * n + k] = acc;
+      }
+    }
+  }
+  for (unsigned int y = 0; y < h; y++) {
+    for (unsigned int i = 0; i < w * n; i++) {
+      float acc = 0.0f;
+      for (int j = -k2; j <= k2; j++)
+        acc += g[j + k2] * tmp[(size_t)borner((int)y + j, h) * w * n + i];
+      s[(size_t)y * w * n + i] = (unsigned char)acc;
+    }
+  }
+  tempsreel_free(tmp);
+}
+
+static void passeHautSeparable(const struct casNoyau *c,
+                               const unsigned char *e, unsigned char *s) {
+  const size_t taille = (size_t)c->hauteur * c->largeur * c->canaux;
+  passeBasSeparable(c, e, s);
+  for (size_t i = 0; i < taille; i++) {
+    int d = abs((int)e[i] - (int)s[i]) * 2;
+    s[i] = (unsigned char)((d < 255) ? d : 255);
+  }
+}
+
+// Lit directement les pixels entrelacés avec la grille (sans _permuteRGB)
+static void plusProcheEntrelace(const struct casNoyau *c,
+                                const unsigned char *e, unsigned char *s) {
+  const unsigned int n = c->canaux;
+  const unsigned int total = c->hauteurSortie * c->largeurSortie;
+  for (unsigned int p = 0; p < total; p++) {
+    const unsigned char *src =
+        e + ((size_t)c->grille.i[p] * c->largeur + c->grille.j[p]) * n;
+    for (unsigned int k = 0; k < n; k++)
+      *s++ = src[k];
+  }
+}
+
+// Même calcul que _ul_bilinear_regulargrid, sur les pixels entrelacés
+static void bilineaireEntrelace(const struct casNoyau *c,
+                                const unsigned char *e, unsigned char *s) {
+  const unsigned int n = c->canaux, w = c->largeur;
+  const unsigned int total = c->hauteurSortie * c->largeurSortie;
+  for (unsigned int p = 0; p < total; p++) {
+    const float x1 = c->grille.i_f[p], x2 = c->grille.j_f[p];
+    const float l = floorf(x2), r = ceilf(x2 + 1e-4f);
+    const float t = floorf(x1), b = ceilf(x1 + 1e-4f);
+    const unsigned char *tl = e + ((size_t)t * w + (size_t)l) * n;
+    const unsigned char *tr = e + ((size_t)t * w + (size_t)r) * n;
+    const unsigned char *bl = e + ((size_t)b * w + (size_t)l) * n;
+    const unsigned char *br = e + ((size_t)b * w + (size_t)r) * n;
+    for (unsigned int k = 0; k < n; k++) {
+      float haut = (r - x2) * (float)tr[k] + (x2 - l) * (float)tl[k];
+      float bas = (r - x2) * (float)br[k] + (x2 - l) * (float)bl[k];
+      *s++ = (unsigned char)((x1 - t) * haut + (b - x1) * bas);
+    }
+  }
+}
+
+// Quatre pixels par itération
+static void grisDeroule(const struct casNoyau *c, const unsigned char *e,
+                        unsigned char *s) {
+  const unsigned int n = c->canaux;
+  unsigned int reste = c->hauteur * c->largeur;
+  for (; reste >= 4; reste -= 4, e += 4 * n, s += 4) {
+    s[0] = (unsigned char)((29 * e[0] + 150 * e[1] + 77 * e[2]) >> 8);
+    s[1] = (unsigned char)((29 * e[n] + 150 * e[n + 1] + 77 * e[n + 2]) >> 8);
+    s[2] = (unsigned char)((29 * e[2 * n] + 150 * e[2 * n + 1] +
+                            77 * e[2 * n + 2]) >> 8);
+    s[3] = (unsigned char)((29 * e[3 * n] + 150 * e[3 * n + 1] +
+                            77 * e[3 * n + 2]) >> 8);
+  }
+  for (; reste > 0; reste--, e += n)
+    *s++ = (unsigned char)((29 * e[0] + 150 * e[1] + 77 * e[2]) >> 8);
+}
+
+static const struct noyau noyaux[] = {
+    {"lowpassFilter", GRILLE_AUCUNE, 1, 0,
+     {{"reference", refPasseBas, 0}, {"separable", passeBasSeparable, 1}}},
+    {"highpassFilter", GRILLE_AUCUNE, 1, 0,
+     {{"reference", refPasseHaut, 0}, {"separable", passeHautSeparable, 2}}},
+    {"resizeNearestNeighbor", GRILLE_PLUS_PROCHE, 0, 0,
+     {{"reference", refPlusProche, 0}, {"entrelace", plusProcheEntrelace, 0}}},
+    {"resizeBilinear", GRILLE_BILINEAIRE, 0, 0,
+     {{"reference", refBilineaire, 0}, {"entrelace", bilineaireEntrelace, 0}}},
+    {"convertToGray", GRILLE_AUCUNE, 0, 1,
+     {{"reference", refGris, 0}, {"deroule", grisDeroule, 0}}},
+};
+
+static const unsigned int hauteurs[] = {160, 240, 480};
+static const unsigned int taillesFiltre[] = {3, 5};
+
+/* Mesure */
+
+static int ouvrirCompteurCycles(void) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = PERF_COUNT_HW_CPU_CYCLES;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t lireCycles(int fd) {
+  uint64_t v = 0;
+  if (fd < 0 || read(fd, &v, sizeof(v)) != (ssize_t)sizeof(v))
+    return 0;
+  return v;
+}
+
+static int comparerU64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+struct resultat {
+  double nsPixel, cv, minNsPixel, octetsCycle, acceleration;
+  int ecart, ok;
+};
+
+static void mesurer(const struct variante *v, const struct casNoyau *cas,
+                    const unsigned char *entree, unsigned char *sortie,
+                    size_t pixels, size_t octets, unsigned int nbMesures,
+                    unsigned int echauffement, int fdCycles, uint64_t *temps,
+                    uint64_t *cycles, struct resultat *r) {
+  for (unsigned int i = 0; i < echauffement; i++)
+    v->fonction(cas, entree, sortie);
+  double somme = 0.0, sommeCarres = 0.0;
+  for (unsigned int i = 0; i < nbMesures; i++) {
+    uint64_t c0 = lireCycles(fdCycles);
+    uint64_t t0 = maintenantNs();
+    v->fonction(cas, entree, sortie);
+    temps[i] = maintenantNs() - t0;
+    cycles[i] = lireCycles(fdCycles) - c0;
+    somme += (double)temps[i];
+    sommeCarres += (double)temps[i] * (double)temps[i];
+  }
+  qsort(temps, nbMesures, sizeof(uint64_t), comparerU64);
+  qsort(cycles, nbMesures, sizeof(uint64_t), comparerU64);
+  double moyenne = somme / nbMesures;
+  double variance = sommeCarres / nbMesures - moyenne * moyenne;
+  r->nsPixel = (double)temps[nbMesures / 2] / pixels;
+  r->minNsPixel = (double)temps[0] / pixels;
+  r->cv = (variance > 0.0) ? 100.0 * sqrt(variance) / moyenne : 0.0;
+  r->octetsCycle = (cycles[nbMesures / 2] > 0)
+                       ? (double)octets / (double)cycles[nbMesures / 2]
+                       : -1.0;
+}
+
+static const char *const colonnesSortie[] = {
+    "noyau",    "hauteur",  "largeur", "canaux",       "param",
+    "variante", "ns_pixel", "cv_pct",  "min_ns_pixel", "octets_cycle",
+    "acceleration", "ecart", "ok"};
+
+static void ecrireResultat(struct sortieMesures *s, const char *noyau,
+                           const struct casNoyau *cas, const char *param,
+                           const char *variante, const struct resultat *r) {
+  char oc[32] = "n/d";
+  if (r->octetsCycle >= 0.0)
+    snprintf(oc, sizeof(oc), "%.3f", r->octetsCycle);
+  printf("%-22s %4ux%-4u %u %-9s %-10s %8.2f %6.1f %8.2f %8s %6.2fx %5d %s\n",
+         noyau, cas->largeur, cas->hauteur, cas->canaux, param, variante,
+         r->nsPixel, r->cv, r->minNsPixel, oc, r->acceleration, r->ecart,
+         r->ok ? "ok" : "ECHEC");
+  mesureTexte(s, noyau);
+  mesureNombre(s, "%u", cas->hauteur);
+  mesureNombre(s, "%u", cas->largeur);
+  mesureNombre(s, "%u", cas->canaux);
+  mesureTexte(s, param);
+  mesureTexte(s, variante);
+  mesureNombre(s, "%.4f", r->nsPixel);
+  mesureNombre(s, "%.2f", r->cv);
+  mesureNombre(s, "%.4f", r->minNsPixel);
+  if (r->octetsCycle >= 0.0)
+    mesureNombre(s, "%s", oc);
+  else
+    mesureAbsente(s);
+  mesureNombre(s, "%.3f", r->acceleration);
+  mesureNombre(s, "%d", r->ecart);
+  mesureBooleen(s, r->ok);
+  finLigneMesures(s);
+}
+
+// Image de test : dégradés et bruit (xorshift), identique d'une exécution à l'autre
+static void remplirImage(unsigned char *image, unsigned int h, unsigned int w,
+                         unsigned int n) {
+  uint32_t x = 2463534242u;
+  for (unsigned int i = 0; i < h; i++) {
+    for (unsigned int j = 0; j < w; j++) {
+      for (unsigned int k = 0; k < n; k++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        image[((size_t)i * w + j) * n + k] =
+            (unsigned char)((i * 255 / h + j * (k + 1) + (x & 31)) & 0xFF);
+      }
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  setbuf(stdout, NULL);
+
+  struct SchedParams params = {
+      .modeOrdonnanceur = ORDONNANCEMENT_NORT,
+      .runtime = 0,
+      .deadline = 0,
+      .period = 0,
+  };
+  unsigned int nbMesures = MESURES_DEFAUT, echauffement = ECHAUFFEMENT_DEFAUT;
+  const char *filtreNoyau = NULL, *nomSortie = NULL;
+
+  int c;
+  opterr = 0;
+  while ((c = getopt(argc, argv, OPTIONS_COMMUNES "r:e:k:S:")) != -1) {
+    switch (c) {
+    case 'r':
+      nbMesures = (unsigned int)atoi(optarg);
+      break;
+    case 'e':
+      echauffement = (unsigned int)atoi(optarg);
+      break;
+    case 'k':
+      filtreNoyau = optarg;
+      break;
+    case 'S':
+      nomSortie = optarg;
+      break;
+    default:
+      parseOptionCommune(c, optarg, &params);
+      break;
+    }
+  }
+  if (nbMesures == 0) {
+    fprintf(stderr, "Usage: %s [options] [-r mesures] [-e echauffement] "
+                    "[-k noyau] [-S fichier]\n",
+            argv[0]);
+    return -1;
+  }
+
+  // Sans -c, reste sur le coeur de départ : une migration en cours de mesure
+  // viderait les caches
+  if (params.masqueCpu == 0) {
+    int coeur = sched_getcpu();
+    if (coeur >= 0 && coeur < 64)
+      params.masqueCpu = 1ULL << coeur;
+  }
+  appliquerOrdonnancement(&params, "benchNoyaux");
+
+  const unsigned int hMax = hauteurs[sizeof(hauteurs) / sizeof(hauteurs[0]) - 1];
+  const unsigned int wMax = (hMax * 16 + 8) / 9;
+  const size_t tailleMax = (size_t)hMax * wMax * 3;
+  // Au plus quatre gros blocs à la fois (deux grilles et deux images
+  // intermédiaires, en float pour les filtres)
+  if (prepareMemoireN(tailleMax * sizeof(float), tailleMax * sizeof(float),
+                      6) != 0) {
+    fprintf(stderr, "[benchNoyaux] Erreur prepareMemoire\n");
+    return -1;
+  }
+  unsigned char *entree = (unsigned char *)malloc(tailleMax);
+  unsigned char *attendu = (unsigned char *)malloc(tailleMax);
+  unsigned char *sortie = (unsigned char *)malloc(tailleMax);
+  uint64_t *temps = (uint64_t *)malloc(nbMesures * sizeof(uint64_t));
+  uint64_t *cycles = (uint64_t *)malloc(nbMesures * sizeof(uint64_t));
+  if (!entree || !attendu || !sortie || !temps || !cycles) {
+    fprintf(stderr, "[benchNoyaux] Erreur d'allocation\n");
+    return -1;
+  }
+
+  struct sortieMesures sortieMesures;
+  if (ouvrirSortieMesures(&sortieMesures, nomSortie, colonnesSortie,
+                          (int)(sizeof(colonnesSortie) /
+                                sizeof(colonnesSortie[0])),
+                          "benchNoyaux") != 0)
+    return -1;
+
+  int fdCycles = ouvrirCompteurCycles();
+  if (fdCycles < 0)
+    printf("[benchNoyaux] Compteur de cycles indisponible (%s) : octets/cycle "
+           "non mesures\n",
+           strerror(errno));
+  printf("[benchNoyaux] %u mesures, %u d'echauffement, coeurs 0x%llx\n",
+         nbMesures, echauffement, (unsigned long long)params.masqueCpu);
+  printf("%-22s %-9s %s %-9s %-10s %8s %6s %8s %8s %7s %5s\n", "noyau",
+         "entree", "c", "param", "variante", "ns/px", "cv%", "min", "o/cycle",
+         "accel", "ecart");
+
+  int echecs = 0;
+  for (size_t n = 0; n < sizeof(noyaux) / sizeof(noyaux[0]); n++) {
+    const struct noyau *ny = &noyaux[n];
+    if (filtreNoyau != NULL && strstr(ny->nom, filtreNoyau) == NULL)
+      continue;
+    for (size_t ih = 0; ih < sizeof(hauteurs) / sizeof(hauteurs[0]); ih++) {
+      for (unsigned int canaux = ny->couleurSeule ? 3 : 1; canaux <= 3;
+           canaux += 2) {
+        for (size_t ip = 0; ip < (ny->filtre ? 2u : 1u); ip++) {
+          struct casNoyau cas = {0};
+          char param[24] = "-";
+          cas.hauteur = hauteurs[ih];
+          cas.largeur = (cas.hauteur * 16 + 8) / 9;
+          cas.canaux = canaux;
+          cas.hauteurSortie = cas.hauteur;
+          cas.largeurSortie = cas.largeur;
+          unsigned int canauxSortie = ny->couleurSeule ? 1 : canaux;
+          if (ny->filtre) {
+            cas.tailleNoyau = taillesFiltre[ip];
+            cas.sigma = 5.0f;
+            snprintf(param, sizeof(param), "%ux%u", cas.tailleNoyau,
+                     cas.tailleNoyau);
+          }
+          if (ny->grille != GRILLE_AUCUNE) {
+            cas.hauteurSortie = cas.hauteur / 2;
+            cas.largeurSortie = cas.largeur / 2;
+            snprintf(param, sizeof(param), "%ux%u", cas.largeurSortie,
+                     cas.hauteurSortie);
+            cas.grille = (ny->grille == GRILLE_PLUS_PROCHE)
+                             ? resizeNearestNeighborInit(
+                                   cas.hauteurSortie, cas.largeurSortie,
+                                   cas.hauteur, cas.largeur)
+                             : resizeBilinearInit(cas.hauteurSortie,
+                                                  cas.largeurSortie,
+                                                  cas.hauteur, cas.largeur);
+          }
+          size_t pixels = (size_t)cas.hauteurSortie * cas.largeurSortie;
+          size_t tailleSortie = pixels * canauxSortie;
+          size_t octets =
+              (size_t)cas.hauteur * cas.largeur * canaux + tailleSortie;
+          remplirImage(entree, cas.hauteur, cas.largeur, canaux);
+
+          double nsReference = 0.0;
+          for (int v = 0; v < MAX_VARIANTES && ny->variantes[v].nom; v++) {
+            const struct variante *va = &ny->variantes[v];
+            struct resultat r = {0};
+            mesurer(va, &cas, entree, (v == 0) ? attendu : sortie, pixels,
+                    octets, nbMesures, echauffement, fdCycles, temps, cycles,
+                    &r);
+            if (v == 0) {
+              nsReference = r.nsPixel;
+            } else {
+              for (size_t i = 0; i < tailleSortie; i++) {
+                int d = abs((int)sortie[i] - (int)attendu[i]);
+                if (d > r.ecart)
+                  r.ecart = d;
+              }
+            }
+            r.ok = (r.ecart <= va->tolerance);
+            r.acceleration = (r.nsPixel > 0.0) ? nsReference / r.nsPixel : 0.0;
+            echecs += !r.ok;
+            ecrireResultat(&sortieMesures, ny->nom, &cas, param, va->nom, &r);
+          }
+          resizeDestroy(cas.grille);
+        }
+      }
+    }
+  }
+
+  fermerSortieMesures(&sortieMesures);
+  if (fdCycles >= 0)
+    close(fdCycles);
+  free(entree);
+  free(attendu);
+  free(sortie);
+  free(temps);
+  free(cycles);
+  if (echecs > 0)
+    printf("[benchNoyaux] %d variante(s) en ECHEC (sortie differente de la "
+           "reference)\n",
+           echecs);
+  return (echecs > 0) ? 1 : 0;
+}
@@ -9,6 +9,573 @@
 
 #include "commMemoirePartagee.h"
 
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#ifndef SYS_futex_waitv
+#define SYS_futex_waitv 449
+#endif
+
+// Équivalent de struct futex_waitv (linux/futex.h), redéfini pour compiler
+// avec des en-têtes noyau antérieurs à 5.16
+struct attenteVecteur {
+  uint64_t valeur;
+  uint64_t adresse;
+  uint32_t drapeaux;
+  uint32_t reserve;
+};
+#define ATTENTE_VECTEUR_32BITS 2
+
+// Triple tampon (POLITIQUE_DERNIERE) : tripleEchange contient l'indice de la
+// case du milieu et, si elle contient une image que le lecteur n'a pas encore
+// prise, le bit TRIPLE_FRAICHE
+#define TRIPLE_NB_CASES 3
+#define TRIPLE_INDICE 0x3u
+#define TRIPLE_FRAICHE 0x100u
+#define ALIGNEMENT_CASES 64
+
+// Diffusion : bits de lecteursEtat
+#define DIFFUSION_A_LIRE(i) (1u << (i))
+#define DIFFUSION_EN_LECTURE(i) (1u << (LECTEURS_MAX + (i)))
+#define DIFFUSION_MASQUE_A_LIRE ((1u << LECTEURS_MAX) - 1)
+#define DIFFUSION_MASQUE_EN_LECTURE (DIFFUSION_MASQUE_A_LIRE << LECTEURS_MAX)
+
+struct optionsCanal optionsCanalDefaut = {
+    .modeSync = MODE_SYNC_PTHREAD,
+    .politique = POLITIQUE_BLOQUANTE,
+    .nbLecteurs = 1,
+    .attenteActiveMaxNs = ATTENTE_ACTIVE_MAX_NS_DEFAUT,
+};
+
+/* -------------------------------------------------------------------------- *
+ *  parseModeSync
+ *  Parse l'argument de l'option -m.
+ * -------------------------------------------------------------------------- */
+int parseModeSync(const char *arg) {
+  if (strcmp(arg, "PTHREAD") == 0) {
+    optionsCanalDefaut.modeSync = MODE_SYNC_PTHREAD;
+  } else if (strcmp(arg, "FUTEX") == 0) {
+    optionsCanalDefaut.modeSync = MODE_SYNC_FUTEX;
+  } else if (strcmp(arg, "FUTEX_PI") == 0) {
+    optionsCanalDefaut.modeSync = MODE_SYNC_FUTEX_PI;
+  } else {
+    optionsCanalDefaut.modeSync = MODE_SYNC_PTHREAD;
+    printf("Mode de synchronisation %s non valide, defaut sur PTHREAD\n", arg);
+    return -1;
+  }
+  return 0;
+}
+
+/* -------------------------------------------------------------------------- *
+ *  parsePolitique
+ *  Parse l'argument de l'option -p.
+ * -------------------------------------------------------------------------- */
+int parsePolitique(const char *arg) {
+  if (strcmp(arg, "BLOQUANTE") == 0) {
+    optionsCanalDefaut.politique = POLITIQUE_BLOQUANTE;
+  } else if (strcmp(arg, "DERNIERE") == 0) {
+    optionsCanalDefaut.politique = POLITIQUE_DERNIERE;
+  } else {
+    optionsCanalDefaut.politique = POLITIQUE_BLOQUANTE;
+    printf("Politique %s non valide, defaut sur BLOQUANTE\n", arg);
+    return -1;
+  }
+  return 0;
+}
+
+/* -------------------------------------------------------------------------- *
+ *  parseNbLecteurs
+ *  Parse l'argument de l'option -n.
+ * -------------------------------------------------------------------------- */
+int parseNbLecteurs(const char *arg) {
+  char *fin;
+  long n = strtol(arg, &fin, 10);
+  if (*arg == '\0' || *fin != '\0' || n < 1 || n > LECTEURS_MAX) {
+    printf("Nombre de lecteurs %s non valide (1 a %d), defaut sur 1\n", arg,
+           LECTEURS_MAX);
+    optionsCanalDefaut.nbLecteurs = 1;
+    return -1;
+  }
+  optionsCanalDefaut.nbLecteurs = (uint32_t)n;
+  return 0;
+}
+
+/* -------------------------------------------------------------------------- *
+ *  Formats de pixels
+ * -------------------------------------------------------------------------- */
+uint32_t formatVideo(const struct videoInfos *infos) {
+  if (infos->format != FORMAT_AUTO)
+    return infos->format;
+  return (infos->canaux == 1) ? FORMAT_GRAY8 : FORMAT_BGR24;
+}
+
+int plansImage(uint32_t format, uint32_t largeur, uint32_t hauteur,
+               struct planImage *plans) {
+  // Les plans de chrominance couvrent les pixels impairs de la dernière
+  // ligne/colonne
+  uint32_t largeurC = (largeur + 1) / 2, hauteurC = (hauteur + 1) / 2;
+  size_t tailleY = (size_t)largeur * hauteur;
+
+  switch (format) {
+  case FORMAT_GRAY8:
+  case FORMAT_BGR24:
+    plans[0].decalage = 0;
+    plans[0].largeur = largeur;
+    plans[0].hauteur = hauteur;
+    plans[0].canaux = (format == FORMAT_GRAY8) ? 1 : 3;
+    return 1;
+  case FORMAT_I420:
+    for (int i = 0; i < 3; i++) {
+      plans[i].largeur = (i == 0) ? largeur : largeurC;
+      plans[i].hauteur = (i == 0) ? hauteur : hauteurC;
+      plans[i].canaux = 1;
+    }
+    plans[0].decalage = 0;
+    plans[1].decalage = tailleY;
+    plans[2].decalage = tailleY + (size_t)largeurC * hauteurC;
+    return 3;
+  case FORMAT_NV12:
+    plans[0].decalage = 0;
+    plans[0].largeur = largeur;
+    plans[0].hauteur = hauteur;
+    plans[0].canaux = 1;
+    plans[1].decalage = tailleY;
+    plans[1].largeur = largeurC;
+    plans[1].hauteur = hauteurC;
+    plans[1].canaux = 2;
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+size_t tailleImageVideo(const struct videoInfos *infos) {
+  struct planImage plans[PLANS_MAX];
+  int nbPlans = plansImage(formatVideo(infos), infos->largeur, infos->hauteur,
+                           plans);
+  size_t taille = 0;
+  for (int i = 0; i < nbPlans; i++)
+    taille += (size_t)plans[i].largeur * plans[i].hauteur * plans[i].canaux;
+  return taille;
+}
+
+int parseFormat(const char *arg) {
+  if (strcmp(arg, "GRAY8") == 0)
+    return FORMAT_GRAY8;
+  if (strcmp(arg, "BGR24") == 0)
+    return FORMAT_BGR24;
+  if (strcmp(arg, "I420") == 0)
+    return FORMAT_I420;
+  if (strcmp(arg, "NV12") == 0)
+    return FORMAT_NV12;
+  return -1;
+}
+
+/* -------------------------------------------------------------------------- *
+ *  parseAttenteActive
+ *  Parse l'argument de l'option -b.
+ * -------------------------------------------------------------------------- */
+int parseAttenteActive(const char *arg) {
+  char *fin = NULL;
+  long valeur = strtol(arg, &fin, 10);
+  if (fin == arg || *fin != '\0' || valeur < 0) {
+    printf("Budget d'attente active %s non valide, defaut sur %d ns\n", arg,
+           ATTENTE_ACTIVE_MAX_NS_DEFAUT);
+    optionsCanalDefaut.attenteActiveMaxNs = ATTENTE_ACTIVE_MAX_NS_DEFAUT;
+    return -1;
+  }
+  optionsCanalDefaut.attenteActiveMaxNs = (uint32_t)valeur;
+  return 0;
+}
+
+/* -------------------------------------------------------------------------- *
+ *  Attente active adaptative
+ *  Sur un système multi-coeur, l'autre processus publie souvent son résultat
+ *  quelques microsecondes après le début de l'attente : il est alors moins
+ *  coûteux de surveiller etat que de s'endormir et d'être réveillé par le
+ *  noyau. Le budget de chaque zone tend vers le double des attentes réussies
+ *  et diminue lorsque l'attente active échoue.
+ * -------------------------------------------------------------------------- */
+static inline void pauseProcesseur(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || (defined(__ARM_ARCH) && __ARM_ARCH >= 7)
+  __asm__ __volatile__("yield" ::: "memory");
+#else
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+static uint64_t tempsNs(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+// Initialise les champs d'attente active d'une zone selon optionsCanalDefaut
+static void initAttenteActive(struct memPartage *zone) {
+  static long nbCoeurs = 0;
+  if (nbCoeurs == 0)
+    nbCoeurs = sysconf(_SC_NPROCESSORS_ONLN);
+
+  zone->attenteActiveMaxNs =
+      (nbCoeurs > 1) ? optionsCanalDefaut.attenteActiveMaxNs : 0;
+  if (zone->attenteActiveMaxNs > 0 &&
+      zone->attenteActiveMaxNs < ATTENTE_ACTIVE_MIN_NS)
+    zone->attenteActiveMaxNs = ATTENTE_ACTIVE_MIN_NS;
+  zone->attenteActiveNs = zone->attenteActiveMaxNs / 2;
+}
+
+// Surveille mot pendant au plus le budget courant de la zone.
+// Retourne 1 si (mot & masque) a pris la valeur voulue, 0 s'il faut bloquer.
+static int attenteActive(struct memPartage *zone, volatile uint32_t *mot,
+                         uint32_t masque, uint32_t voulu) {
+  if (zone->attenteActiveMaxNs == 0 ||
+      (__atomic_load_n(mot, __ATOMIC_ACQUIRE) & masque) == voulu)
+    return 0;
+
+  uint64_t debut = tempsNs();
+  uint64_t ecoule = 0;
+  for (unsigned int i = 1;; i++) {
+    pauseProcesseur();
+    if ((__atomic_load_n(mot, __ATOMIC_ACQUIRE) & masque) == voulu) {
+      ecoule = tempsNs() - debut;
+      int64_t cible = (int64_t)(2 * ecoule);
+      int64_t budget = (int64_t)zone->attenteActiveNs;
+      budget += (cible - budget) / 8;
+      if (budget > (int64_t)zone->attenteActiveMaxNs)
+        budget = zone->attenteActiveMaxNs;
+      if (budget < ATTENTE_ACTIVE_MIN_NS)
+        budget = ATTENTE_ACTIVE_MIN_NS;
+      zone->attenteActiveNs = (uint32_t)budget;
+      return 1;
+    }
+    // Lire l'horloge coûte plus cher qu'une itération : on l'espace
+    if ((i & 31) == 0) {
+      ecoule = tempsNs() - debut;
+      if (ecoule >= zone->attenteActiveNs)
+        break;
+    }
+  }
+
+  zone->attenteActiveNs -= zone->attenteActiveNs / 4;
+  if (zone->attenteActiveNs < ATTENTE_ACTIVE_MIN_NS)
+    zone->attenteActiveNs = ATTENTE_ACTIVE_MIN_NS;
+  return 0;
+}
+
+/* -------------------------------------------------------------------------- *
+ *  Primitives futex
+ *  Les zones sont partagées entre processus : on n'utilise donc jamais
+ *  FUTEX_PRIVATE_FLAG.
+ * -------------------------------------------------------------------------- */
+static long futex(volatile uint32_t *adresse, int op, uint32_t valeur,
+                  const struct timespec *delai) {
+  return syscall(SYS_futex, adresse, op, valeur, delai, NULL, 0);
+}
+
+static uint32_t tidCourant(void) {
+  static __thread uint32_t tid = 0;
+  if (tid == 0)
+    tid = (uint32_t)syscall(SYS_gettid);
+  return tid;
+}
+
+// Dort tant que etat vaut encore valeurVue. Le compteur enAttente permet à
+// l'autre processus de ne faire l'appel système FUTEX_WAKE que si nécessaire.
+static void attenteEtat(struct memPartageHeader *hdr, uint32_t valeurVue) {
+  __atomic_add_fetch(&hdr->enAttente, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&hdr->etat, __ATOMIC_SEQ_CST) == valeurVue)
+    futex(&hdr->etat, FUTEX_WAIT, valeurVue, NULL);
+  __atomic_sub_fetch(&hdr->enAttente, 1, __ATOMIC_SEQ_CST);
+}
+
+// Comme attenteEtat, pour un autre mot de la zone (triple tampon, diffusion)
+static void attenteMot(struct memPartageHeader *hdr, volatile uint32_t *mot,
+                       uint32_t valeurVue) {
+  __atomic_add_fetch(&hdr->enAttente, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(mot, __ATOMIC_SEQ_CST) == valeurVue)
+    futex(mot, FUTEX_WAIT, valeurVue, NULL);
+  __atomic_sub_fetch(&hdr->enAttente, 1, __ATOMIC_SEQ_CST);
+}
+
+// Publie un nouvel état et réveille l'autre processus s'il est endormi
+static void publierEtat(struct memPartageHeader *hdr, uint32_t etat) {
+  __atomic_store_n(&hdr->etat, etat, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&hdr->enAttente, __ATOMIC_SEQ_CST) > 0)
+    futex(&hdr->etat, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+// Verrou à héritage de priorité : le chemin rapide (non contesté) est un
+// simple CAS 0 -> TID, le noyau n'intervient qu'en cas de contention.
+static void verrouillerPI(struct memPartageHeader *hdr) {
+  uint32_t libre = 0;
+  if (__atomic_compare_exchange_n(&hdr->verrouPI, &libre, tidCourant(), 0,
+                                  __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    return;
+  while (futex(&hdr->verrouPI, FUTEX_LOCK_PI, 0, NULL) == -1 && errno == EINTR)
+    ;
+}
+
+static int essayerVerrouPI(struct memPartageHeader *hdr) {
+  uint32_t libre = 0;
+  return __atomic_compare_exchange_n(&hdr->verrouPI, &libre, tidCourant(), 0,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void deverrouillerPI(struct memPartageHeader *hdr) {
+  uint32_t moi = tidCourant();
+  if (__atomic_compare_exchange_n(&hdr->verrouPI, &moi, 0, 0,
+                                  __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    return;
+  // Des processus attendent dans le noyau (bit FUTEX_WAITERS)
+  futex(&hdr->verrouPI, FUTEX_UNLOCK_PI, 0, NULL);
+}
+
+// Attend que etat prenne la valeur voulue (modes FUTEX et FUTEX_PI). En mode
+// FUTEX_PI, le verrou est détenu au retour, comme le mutex en mode PTHREAD.
+static void attenteFutex(struct memPartage *zone, uint32_t voulu) {
+  struct memPartageHeader *hdr = zone->header;
+  int pi = (hdr->modeSync == MODE_SYNC_FUTEX_PI);
+  attenteActive(zone, &hdr->etat, ~0u, voulu);
+  while (1) {
+    if (pi)
+      verrouillerPI(hdr);
+    uint32_t vu = __atomic_load_n(&hdr->etat, __ATOMIC_ACQUIRE);
+    if (vu == voulu)
+      return;
+    if (pi)
+      deverrouillerPI(hdr);
+    attenteEtat(hdr, vu);
+  }
+}
+
+// Réveille les processus endormis sur etat par attenteLecteurMultiple, en
+// mode PTHREAD (en mode FUTEX, publierEtat s'en charge déjà)
+static void reveillerAttenteMultiple(struct memPartageHeader *hdr) {
+  if (__atomic_load_n(&hdr->enAttente, __ATOMIC_SEQ_CST) > 0)
+    futex(&hdr->etat, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+static void signalFutex(struct memPartageHeader *hdr, uint32_t etat) {
+  if (hdr->modeSync == MODE_SYNC_FUTEX_PI) {
+    __atomic_store_n(&hdr->etat, etat, __ATOMIC_SEQ_CST);
+    deverrouillerPI(hdr);
+    if (__atomic_load_n(&hdr->enAttente, __ATOMIC_SEQ_CST) > 0)
+      futex(&hdr->etat, FUTEX_WAKE, INT_MAX, NULL);
+    return;
+  }
+  publierEtat(hdr, etat);
+}
+
+/* -------------------------------------------------------------------------- *
+ *  Triple tampon (POLITIQUE_DERNIERE)
+ *  Chaque processus détient en permanence une des trois cases (caseLocale);
+ *  la troisième est « au milieu ». L'écrivain publie en échangeant sa case
+ *  avec celle du milieu, le lecteur prend une image en faisant de même. Un
+ *  seul échange atomique par image : l'écrivain ne bloque jamais.
+ * -------------------------------------------------------------------------- */
+static int estDiffusion(const struct memPartageHeader *hdr) {
+  return hdr->nbLecteurs > 1;
+}
+
+static int estTriple(const struct memPartageHeader *hdr) {
+  return hdr->politique == POLITIQUE_DERNIERE && !estDiffusion(hdr);
+}
+
+static size_t nbCases(const struct memPartageHeader *hdr) {
+  return estTriple(hdr) ? TRIPLE_NB_CASES : 1;
+}
+
+static size_t pasCases(size_t tailleDonnees) {
+  return (tailleDonnees + ALIGNEMENT_CASES - 1) / ALIGNEMENT_CASES *
+         ALIGNEMENT_CASES;
+}
+
+static size_t tailleZoneDonnees(const struct memPartageHeader *hdr) {
+  if (nbCases(hdr) == 1)
+    return hdr->tailleDonnees;
+  return nbCases(hdr) * pasCases(hdr->tailleDonnees);
+}
+
+static unsigned char *adresseCase(struct memPartage *zone, uint32_t indice) {
+  return (unsigned char *)(zone->header + 1) +
+         indice * pasCases(zone->tailleDonnees);
+}
+
+// Le lecteur prend la case du milieu (fraîche) et y laisse la sienne
+static void prendreTriple(struct memPartage *zone) {
+  uint32_t ancien = __atomic_exchange_n(&zone->header->tripleEchange,
+                                        zone->caseLocale, __ATOMIC_ACQ_REL);
+  zone->caseLocale = ancien & TRIPLE_INDICE;
+  zone->data = adresseCase(zone, zone->caseLocale);
+}
+
+static void attenteLecteurTriple(struct memPartage *zone) {
+  struct memPartageHeader *hdr = zone->header;
+  attenteActive(zone, &hdr->tripleEchange, TRIPLE_FRAICHE, TRIPLE_FRAICHE);
+  while (1) {
+    uint32_t vu = __atomic_load_n(&hdr->tripleEchange, __ATOMIC_SEQ_CST);
+    if (vu & TRIPLE_FRAICHE)
+      break;
+    attenteMot(hdr, &hdr->tripleEchange, vu);
+  }
+  prendreTriple(zone);
+}
+
+// L'écrivain publie sa case; si la case du milieu n'avait pas été prise,
+// l'image qu'elle contenait est perdue
+static void publierTriple(struct memPartage *zone) {
+  struct memPartageHeader *hdr = zone->header;
+  uint32_t ancien = __atomic_exchange_n(
+      &hdr->tripleEchange, zone->caseLocale | TRIPLE_FRAICHE, __ATOMIC_SEQ_CST);
+  if (ancien & TRIPLE_FRAICHE)
+    __atomic_add_fetch(&hdr->tramesPerdues, 1, __ATOMIC_RELAXED);
+  zone->caseLocale = ancien & TRIPLE_INDICE;
+  zone->data = adresseCase(zone, zone->caseLocale);
+  if (__atomic_load_n(&hdr->enAttente, __ATOMIC_SEQ_CST) > 0)
+    futex(&hdr->tripleEchange, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+/* -------------------------------------------------------------------------- *
+ *  Diffusion (plusieurs lecteurs)
+ *  L'écrivain publie en marquant « à lire » tous les lecteurs inscrits. Un
+ *  lecteur prend l'image en passant son bit de « à lire » à « en lecture »
+ *  (CAS), puis le retire dans signalLecteur. La zone est libre lorsque
+ *  lecteursEtat vaut zéro. Tous les processus dorment sur lecteursEtat.
+ * -------------------------------------------------------------------------- */
+static int inscrireLecteur(struct memPartage *zone) {
+  struct memPartageHeader *hdr = zone->header;
+  uint32_t inscrits = __atomic_load_n(&hdr->inscrits, __ATOMIC_ACQUIRE);
+  uint32_t i;
+  do {
+    for (i = 0; i < hdr->nbLecteurs; i++)
+      if (!(inscrits & (1u << i)))
+        break;
+    if (i == hdr->nbLecteurs) {
+      fprintf(stderr,
+              "initMemoirePartageeLecteur: les %u lecteurs sont deja inscrits\n",
+              hdr->nbLecteurs);
+      return -1;
+    }
+  } while (!__atomic_compare_exchange_n(&hdr->inscrits, &inscrits,
+                                        inscrits | (1u << i), 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE));
+  zone->indiceLecteur = (int32_t)i;
+  futex(&hdr->inscrits, FUTEX_WAKE, INT_MAX, NULL);
+  return 0;
+}
+
+// Tente de prendre l'image courante; retourne 1 si elle était à lire pour nous
+static int prendreDiffusion(struct memPartage *zone) {
+  struct memPartageHeader *hdr = zone->header;
+  uint32_t aLire = DIFFUSION_A_LIRE(zone->indiceLecteur);
+  uint32_t vu = __atomic_load_n(&hdr->lecteursEtat, __ATOMIC_ACQUIRE);
+  while (vu & aLire) {
+    if (__atomic_compare_exchange_n(
+            &hdr->lecteursEtat, &vu,
+            (vu & ~aLire) | DIFFUSION_EN_LECTURE(zone->indiceLecteur), 0,
+            __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+      return 1;
+  }
+  return 0;
+}
+
+static void attenteLecteurDiffusion(struct memPartage *zone) {
+  struct memPartageHeader *hdr = zone->header;
+  uint32_t aLire = DIFFUSION_A_LIRE(zone->indiceLecteur);
+  attenteActive(zone, &hdr->lecteursEtat, aLire, aLire);
+  while (!prendreDiffusion(zone)) {
+    uint32_t vu = __atomic_load_n(&hdr->lecteursEtat, __ATOMIC_SEQ_CST);
+    if (!(vu & aLire))
+      attenteMot(hdr, &hdr->lecteursEtat, vu);
+  }
+}
+
+static void signalLecteurDiffusion(struct memPartage *zone) {
+  struct memPartageHeader *hdr = zone->header;
+  uint32_t reste =
+      __atomic_and_fetch(&hdr->lecteursEtat,
+                         ~DIFFUSION_EN_LECTURE(zone->indiceLecteur),
+                         __ATOMIC_SEQ_CST);
+  if (!(reste & DIFFUSION_MASQUE_EN_LECTURE) &&
+      __atomic_load_n(&hdr->enAttente, __ATOMIC_SEQ_CST) > 0)
+    futex(&hdr->lecteursEtat, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+static void attenteEcrivainDiffusion(struct memPartage *zone) {
+  struct memPartageHeader *hdr = zone->header;
+
+  // Aucune image n'est publiée avant que tous les lecteurs soient inscrits
+  uint32_t tous = (1u << hdr->nbLecteurs) - 1;
+  uint32_t inscrits;
+  while ((inscrits = __atomic_load_n(&hdr->inscrits, __ATOMIC_SEQ_CST)) != tous)
+    attenteMot(hdr, &hdr->inscrits, inscrits);
+
+  int perte = (hdr->politique == POLITIQUE_DERNIERE);
+  attenteActive(zone, &hdr->lecteursEtat,
+                perte ? DIFFUSION_MASQUE_EN_LECTURE : ~0u, 0);
+  uint32_t vu = __atomic_load_n(&hdr->lecteursEtat, __ATOMIC_SEQ_CST);
+  while (1) {
+    if (perte && (vu & DIFFUSION_MASQUE_A_LIRE)) {
+      // Les lecteurs qui n'ont pas encore commencé sautent cette image
+      if (!__atomic_compare_exchange_n(&hdr->lecteursEtat, &vu,
+                                       vu & ~DIFFUSION_MASQUE_A_LIRE, 0,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+        continue;
+      for (uint32_t i = 0; i < hdr->nbLecteurs; i++)
+        if (vu & DIFFUSION_A_LIRE(i))
+          __atomic_add_fetch(&hdr->sautees[i], 1, __ATOMIC_RELAXED);
+      __atomic_add_fetch(&hdr->tramesPerdues, 1, __ATOMIC_RELAXED);
+      vu &= ~DIFFUSION_MASQUE_A_LIRE;
+    }
+    if (vu == 0)
+      break;
+    attenteMot(hdr, &hdr->lecteursEtat, vu);
+    vu = __atomic_load_n(&hdr->lecteursEtat, __ATOMIC_SEQ_CST);
+  }
+}
+
+static void signalEcrivainDiffusion(struct memPartage *zone) {
+  struct memPartageHeader *hdr = zone->header;
+  __atomic_store_n(&hdr->lecteursEtat, (1u << hdr->nbLecteurs) - 1,
+                   __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&hdr->enAttente, __ATOMIC_SEQ_CST) > 0)
+    futex(&hdr->lecteursEtat, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+// Mot sur lequel un lecteur attend des données, et valeur (sous le masque)
+// indiquant qu'une image est disponible pour lui
+static volatile uint32_t *motLecteur(const struct memPartage *zone,
+                                     uint32_t *masque, uint32_t *voulu) {
+  struct memPartageHeader *hdr = zone->header;
+  if (estDiffusion(hdr)) {
+    *masque = *voulu = DIFFUSION_A_LIRE(zone->indiceLecteur);
+    return &hdr->lecteursEtat;
+  }
+  if (estTriple(hdr)) {
+    *masque = *voulu = TRIPLE_FRAICHE;
+    return &hdr->tripleEchange;
+  }
+  *masque = ~0u;
+  *voulu = ETAT_PRET_AVEC_DONNEES;
+  return &hdr->etat;
+}
+
+void propagerSautees(const struct memPartage *entree, struct memPartage *sortie) {
+  __atomic_store_n(
+      &sortie->header->tramesSauteesAmont,
+      __atomic_load_n(&entree->header->tramesSauteesAmont, __ATOMIC_RELAXED),
+      __ATOMIC_RELAXED);
+}
+
+uint32_t tramesPerduesLecteur(const struct memPartage *zone) {
+  if (estDiffusion(zone->header) && zone->indiceLecteur >= 0)
+    return zone->header->sautees[zone->indiceLecteur];
+  return zone->header->tramesPerdues;
+}
+
 /* -------------------------------------------------------------------------- *
  *  initMemoirePartageeEcrivain
  *  Crée et mappe la zone mémoire partagée du côté écrivain.
@@ -16,15 +583,32 @@
 int initMemoirePartageeEcrivain(const char *identifiant,
                                 struct memPartage *zone,
                                 struct videoInfos *infos) {
+  size_t tailleDonnees = tailleImageVideo(infos);
+  return initMemoirePartageeEcrivainTaille(identifiant, zone, infos,
+                                           tailleDonnees);
+}
+
+/* -------------------------------------------------------------------------- *
+ *  initMemoirePartageeEcrivainTaille
+ *  Identique à initMemoirePartageeEcrivain, mais la taille de la zone de
+ *  données est donnée explicitement (et inscrite dans le header).
+ * -------------------------------------------------------------------------- */
+int initMemoirePartageeEcrivainTaille(const char *identifiant,
+                                      struct memPartage *zone,
+                                      struct videoInfos *infos,
+                                      size_t tailleDonnees) {
   zone->fd = shm_open(identifiant, O_CREAT | O_RDWR | O_TRUNC, 0666);
   if (zone->fd == -1) {
     perror("initMemoirePartageeEcrivain: shm_open");
     return -1;
   }
 
-  size_t tailleDonnees =
-      (size_t)infos->largeur * infos->hauteur * infos->canaux;
-  size_t tailleTotal = sizeof(struct memPartageHeader) + tailleDonnees;
+  uint32_t politique = optionsCanalDefaut.politique;
+  uint32_t nbLecteurs = optionsCanalDefaut.nbLecteurs;
+  size_t tailleCases = (politique == POLITIQUE_DERNIERE && nbLecteurs <= 1)
+                           ? TRIPLE_NB_CASES * pasCases(tailleDonnees)
+                           : tailleDonnees;
+  size_t tailleTotal = sizeof(struct memPartageHeader) + tailleCases;
 
   if (ftruncate(zone->fd, (off_t)tailleTotal) == -1) {
     perror("initMemoirePartageeEcrivain: ftruncate");
@@ -41,9 +625,25 @@ int initMemoirePartageeEcrivain(const char *identifiant,
   zone->header = (struct memPartageHeader *)ptr;
   zone->data = (unsigned char *)(zone->header + 1);
   zone->tailleDonnees = tailleDonnees;
+  initAttenteActive(zone);
 
   zone->header->infos = *infos;
+  zone->header->tailleDonnees = (uint32_t)tailleDonnees;
+  zone->header->modeSync = optionsCanalDefaut.modeSync;
+  zone->header->enAttente = 0;
+  zone->header->verrouPI = 0;
+  zone->header->politique = politique;
+  zone->header->tripleEchange = 1; // l'écrivain détient la case 0, le lecteur la 2
+  zone->header->tramesPerdues = 0;
+  zone->header->tramesSauteesAmont = 0;
+  zone->header->nbLecteurs = nbLecteurs;
+  zone->header->inscrits = 0;
+  zone->header->lecteursEtat = 0;
+  for (uint32_t i = 0; i < LECTEURS_MAX; i++)
+    zone->header->sautees[i] = 0;
   zone->header->etat = ETAT_NON_INITIALISE;
+  zone->caseLocale = 0;
+  zone->indiceLecteur = -1;
 
   pthread_mutexattr_t mattr;
   pthread_mutexattr_init(&mattr);
@@ -60,7 +660,8 @@ int initMemoirePartageeEcrivain(const char *identifiant,
   pthread_cond_init(&zone->header->condLecteur, &cattr);
   pthread_condattr_destroy(&cattr);
 
-  zone->header->etat = ETAT_PRET_SANS_DONNEES;
+  __atomic_store_n(&zone->header->etat, ETAT_PRET_SANS_DONNEES,
+                   __ATOMIC_RELEASE);
 
   return 0;
 }
@@ -101,9 +702,8 @@ int initMemoirePartageeLecteur(const char *identifiant,
   while (hdr->etat == ETAT_NON_INITIALISE)
     usleep(DELAI_INIT_READER_USEC);
 
-  size_t tailleDonnees =
-      (size_t)hdr->infos.largeur * hdr->infos.hauteur * hdr->infos.canaux;
-  size_t tailleTotal = sizeof(struct memPartageHeader) + tailleDonnees;
+  size_t tailleDonnees = hdr->tailleDonnees;
+  size_t tailleTotal = sizeof(struct memPartageHeader) + tailleZoneDonnees(hdr);
 
   munmap(hdr, sizeof(struct memPartageHeader));
 
@@ -117,6 +717,15 @@ int initMemoirePartageeLecteur(const char *identifiant,
   zone->header = (struct memPartageHeader *)ptr;
   zone->data = (unsigned char *)(zone->header + 1);
   zone->tailleDonnees = tailleDonnees;
+  zone->caseLocale = 0;
+  zone->indiceLecteur = -1;
+  if (estTriple(zone->header)) {
+    zone->caseLocale = TRIPLE_NB_CASES - 1;
+    zone->data = adresseCase(zone, zone->caseLocale);
+  }
+  if (estDiffusion(zone->header) && inscrireLecteur(zone) != 0)
+    return -1;
+  initAttenteActive(zone);
 
   return 0;
 }
@@ -124,9 +733,22 @@ int initMemoirePartageeLecteur(const char *identifiant,
 /* -------------------------------------------------------------------------- *
  *  attenteLecteur
  *  Bloque jusqu'à ce que l'état soit ETAT_PRET_AVEC_DONNEES.
- *  Le mutex est verrouillé au retour.
+ *  Le mutex est verrouillé au retour (mode PTHREAD).
  * -------------------------------------------------------------------------- */
 int attenteLecteur(struct memPartage *zone) {
+  if (estDiffusion(zone->header)) {
+    attenteLecteurDiffusion(zone);
+    return 0;
+  }
+  if (estTriple(zone->header)) {
+    attenteLecteurTriple(zone);
+    return 0;
+  }
+  if (zone->header->modeSync != MODE_SYNC_PTHREAD) {
+    attenteFutex(zone, ETAT_PRET_AVEC_DONNEES);
+    return 0;
+  }
+  attenteActive(zone, &zone->header->etat, ~0u, ETAT_PRET_AVEC_DONNEES);
   pthread_mutex_lock(&zone->header->mutex);
   while (zone->header->etat != ETAT_PRET_AVEC_DONNEES)
     pthread_cond_wait(&zone->header->condLecteur, &zone->header->mutex);
@@ -139,20 +761,54 @@ int attenteLecteur(struct memPartage *zone) {
  *  Retourne 1 (mutex verrouillé, données dispo) ou 0 (rien de dispo).
  * -------------------------------------------------------------------------- */
 int attenteLecteurAsync(struct memPartage *zone) {
-  if (pthread_mutex_trylock(&zone->header->mutex) != 0)
+  struct memPartageHeader *hdr = zone->header;
+  if (estDiffusion(hdr))
+    return prendreDiffusion(zone);
+  if (estTriple(hdr)) {
+    if (!(__atomic_load_n(&hdr->tripleEchange, __ATOMIC_ACQUIRE) &
+          TRIPLE_FRAICHE))
+      return 0;
+    prendreTriple(zone);
+    return 1;
+  }
+  if (hdr->modeSync != MODE_SYNC_PTHREAD) {
+    if (__atomic_load_n(&hdr->etat, __ATOMIC_ACQUIRE) != ETAT_PRET_AVEC_DONNEES)
+      return 0;
+    if (hdr->modeSync == MODE_SYNC_FUTEX)
+      return 1;
+    if (!essayerVerrouPI(hdr))
+      return 0;
+    if (__atomic_load_n(&hdr->etat, __ATOMIC_ACQUIRE) == ETAT_PRET_AVEC_DONNEES)
+      return 1;
+    deverrouillerPI(hdr);
     return 0;
-  if (zone->header->etat == ETAT_PRET_AVEC_DONNEES)
+  }
+  if (pthread_mutex_trylock(&hdr->mutex) != 0)
+    return 0;
+  if (hdr->etat == ETAT_PRET_AVEC_DONNEES)
     return 1;
-  pthread_mutex_unlock(&zone->header->mutex);
+  pthread_mutex_unlock(&hdr->mutex);
   return 0;
 }
 
 /* -------------------------------------------------------------------------- *
  *  attenteEcrivain
  *  Bloque jusqu'à ce que l'état soit ETAT_PRET_SANS_DONNEES.
- *  Le mutex est verrouillé au retour.
+ *  Le mutex est verrouillé au retour (mode PTHREAD).
  * -------------------------------------------------------------------------- */
 int attenteEcrivain(struct memPartage *zone) {
+  if (estDiffusion(zone->header)) {
+    attenteEcrivainDiffusion(zone);
+    return 0;
+  }
+  // Avec le triple tampon, l'écrivain détient toujours une case libre
+  if (estTriple(zone->header))
+    return 0;
+  if (zone->header->modeSync != MODE_SYNC_PTHREAD) {
+    attenteFutex(zone, ETAT_PRET_SANS_DONNEES);
+    return 0;
+  }
+  attenteActive(zone, &zone->header->etat, ~0u, ETAT_PRET_SANS_DONNEES);
   pthread_mutex_lock(&zone->header->mutex);
   while (zone->header->etat != ETAT_PRET_SANS_DONNEES)
     pthread_cond_wait(&zone->header->condEcrivain, &zone->header->mutex);
@@ -164,6 +820,17 @@ int attenteEcrivain(struct memPartage *zone) {
  *  Appelée par le lecteur après avoir lu : libère l'écrivain.
  * -------------------------------------------------------------------------- */
 void signalLecteur(struct memPartage *zone) {
+  if (estDiffusion(zone->header)) {
+    signalLecteurDiffusion(zone);
+    return;
+  }
+  // Avec le triple tampon, le lecteur garde sa case jusqu'à la prochaine image
+  if (estTriple(zone->header))
+    return;
+  if (zone->header->modeSync != MODE_SYNC_PTHREAD) {
+    signalFutex(zone->header, ETAT_PRET_SANS_DONNEES);
+    return;
+  }
   zone->header->etat = ETAT_PRET_SANS_DONNEES;
   pthread_cond_signal(&zone->header->condEcrivain);
   pthread_mutex_unlock(&zone->header->mutex);
@@ -174,7 +841,98 @@ void signalLecteur(struct memPartage *zone) {
  *  Appelée par l'écrivain après avoir écrit : réveille le lecteur.
  * -------------------------------------------------------------------------- */
 void signalEcrivain(struct memPartage *zone) {
-  zone->header->etat = ETAT_PRET_AVEC_DONNEES;
+  if (estDiffusion(zone->header)) {
+    signalEcrivainDiffusion(zone);
+    return;
+  }
+  if (estTriple(zone->header)) {
+    publierTriple(zone);
+    return;
+  }
+  if (zone->header->modeSync != MODE_SYNC_PTHREAD) {
+    signalFutex(zone->header, ETAT_PRET_AVEC_DONNEES);
+    return;
+  }
+  __atomic_store_n(&zone->header->etat, ETAT_PRET_AVEC_DONNEES,
+                   __ATOMIC_SEQ_CST);
   pthread_cond_signal(&zone->header->condLecteur);
   pthread_mutex_unlock(&zone->header->mutex);
+  reveillerAttenteMultiple(zone->header);
+}
+
+/* -------------------------------------------------------------------------- *
+ *  attenteLecteurMultiple
+ *  Attend qu'une des zones contienne des données (futex_waitv sur le mot etat
+ *  de chacune), ou que l'échéance soit atteinte.
+ * -------------------------------------------------------------------------- */
+int attenteLecteurMultiple(struct memPartage **zones, int nbZones,
+                           const struct timespec *echeance) {
+  static int waitvDisponible = 1;
+  struct attenteVecteur attentes[nbZones > 0 ? nbZones : 1];
+
+  if (nbZones <= 0) {
+    if (echeance != NULL)
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, echeance, NULL);
+    return -1;
+  }
+
+  for (int i = 0; i < nbZones; i++)
+    __atomic_add_fetch(&zones[i]->header->enAttente, 1, __ATOMIC_SEQ_CST);
+
+  int pret = -1;
+  while (pret < 0) {
+    // Vérification après l'incrément de enAttente : un écrivain qui publie
+    // maintenant verra forcément notre présence et fera FUTEX_WAKE sur le mot
+    // surveillé par ce lecteur (voir motLecteur)
+    for (int i = 0; i < nbZones && pret < 0; i++) {
+      uint32_t masque, voulu;
+      volatile uint32_t *mot = motLecteur(zones[i], &masque, &voulu);
+      uint32_t vu = __atomic_load_n(mot, __ATOMIC_SEQ_CST);
+      if ((vu & masque) == voulu)
+        pret = i;
+      attentes[i].valeur = vu;
+      attentes[i].adresse = (uint64_t)(uintptr_t)mot;
+      attentes[i].drapeaux = ATTENTE_VECTEUR_32BITS;
+      attentes[i].reserve = 0;
+    }
+    if (pret >= 0)
+      break;
+
+    struct timespec maintenant;
+    clock_gettime(CLOCK_MONOTONIC, &maintenant);
+    if (echeance != NULL &&
+        (maintenant.tv_sec > echeance->tv_sec ||
+         (maintenant.tv_sec == echeance->tv_sec &&
+          maintenant.tv_nsec >= echeance->tv_nsec)))
+      break;
+
+    if (waitvDisponible) {
+      long r = syscall(SYS_futex_waitv, attentes, (unsigned int)nbZones, 0,
+                       echeance, CLOCK_MONOTONIC);
+      if (r >= 0 || errno == EAGAIN || errno == EINTR || errno == ETIMEDOUT)
+        continue;
+      if (errno == ENOSYS)
+        waitvDisponible = 0;
+      else
+        perror("attenteLecteurMultiple: futex_waitv");
+    }
+
+    // Repli : sommeil par tranches jusqu'à l'échéance
+    struct timespec reveil = maintenant;
+    reveil.tv_nsec += DELAI_ATTENTE_MULTIPLE_NS;
+    if (reveil.tv_nsec >= 1000000000L) {
+      reveil.tv_nsec -= 1000000000L;
+      reveil.tv_sec++;
+    }
+    if (echeance != NULL &&
+        (echeance->tv_sec < reveil.tv_sec ||
+         (echeance->tv_sec == reveil.tv_sec &&
+          echeance->tv_nsec < reveil.tv_nsec)))
+      reveil = *echeance;
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &reveil, NULL);
+  }
+
+  for (int i = 0; i < nbZones; i++)
+    __atomic_sub_fetch(&zones[i]->header->enAttente, 1, __ATOMIC_SEQ_CST);
+  return pret;
 }
@@ -38,6 +38,59 @@ extern "C"
 // Délai entre deux tentatives d'initialisation du lecteur
 #define DELAI_INIT_READER_USEC 1000
 
+// Modes de synchronisation d'une zone (choisis par l'écrivain, suivis par le lecteur)
+// PTHREAD  : mutex partagé, robuste et à héritage de priorité + deux conditions
+// FUTEX    : transitions atomiques sur etat, FUTEX_WAIT/FUTEX_WAKE seulement si
+//            l'autre processus est réellement endormi
+// FUTEX_PI : comme FUTEX, mais la zone est aussi protégée par un verrou
+//            FUTEX_LOCK_PI (héritage de priorité, pour les modes temps réel)
+#define MODE_SYNC_PTHREAD 0
+#define MODE_SYNC_FUTEX 1
+#define MODE_SYNC_FUTEX_PI 2
+
+// Politiques de l'écrivain (choisies par l'écrivain, suivies par le lecteur)
+// BLOQUANTE : l'écrivain attend que le lecteur ait lu l'image précédente (défaut)
+// DERNIERE  : l'écrivain ne bloque jamais. La zone contient trois cases (triple
+//             tampon) : l'écrivain remplit la sienne puis l'échange avec la case du
+//             milieu, et le lecteur prend toujours l'image complète la plus récente.
+//             Les images écrasées avant d'avoir été lues sont comptées dans
+//             tramesPerdues. Le mode de synchronisation (-m) est alors ignoré.
+#define POLITIQUE_BLOQUANTE 0
+#define POLITIQUE_DERNIERE 1
+
+// Diffusion : une zone créée avec plusieurs lecteurs (option -n) est lue par chacun
+// d'eux. Chaque lecteur s'inscrit à l'ouverture et possède deux bits dans
+// lecteursEtat (« à lire » et « en lecture »); l'écrivain ne réécrit la zone que
+// lorsque tous les lecteurs ont relâché l'image précédente. En POLITIQUE_DERNIERE,
+// les lecteurs qui n'ont pas encore commencé à lire l'image précédente la sautent
+// (compteur sautees propre à chaque lecteur) au lieu de bloquer l'écrivain.
+// Une zone de diffusion n'a qu'une case et est toujours synchronisée par futex.
+#define LECTEURS_MAX 8
+
+// Attente active (en nanosecondes) tentée avant de bloquer dans attenteLecteur et
+// attenteEcrivain. Le budget courant s'ajuste selon les attentes observées, entre
+// ATTENTE_ACTIVE_MIN_NS et le maximum configuré (option -b, 0 pour désactiver).
+// L'attente active est toujours désactivée sur un système à un seul coeur (Pi Zero).
+#define ATTENTE_ACTIVE_MAX_NS_DEFAUT 20000
+#define ATTENTE_ACTIVE_MIN_NS 500
+
+// Formats de pixels transportés dans une zone (videoInfos.format)
+// AUTO  : déduit de canaux (1 = GRAY8, 3 = BGR24), pour les écrivains qui l'ignorent
+// GRAY8 : un octet par pixel
+// BGR24 : trois octets entrelacés par pixel
+// I420  : YCbCr 4:2:0 planaire; plan Y pleine résolution, puis plans U et V de
+//         ceil(L/2) x ceil(H/2) pixels (1,5 octet par pixel)
+// NV12  : comme I420, mais U et V entrelacés dans un seul plan (UVUV...)
+// Les étapes de traitement opèrent plan par plan; seul le compositeur revient en BGR.
+#define FORMAT_AUTO 0
+#define FORMAT_GRAY8 1
+#define FORMAT_BGR24 2
+#define FORMAT_I420 3
+#define FORMAT_NV12 4
+
+// Pas de scrutation de attenteLecteurMultiple lorsque futex_waitv n'est pas disponible
+#define DELAI_ATTENTE_MULTIPLE_NS 500000
+
     // Le reste de ce fichier constitue une suggestion de structures et fonctions
     // à créer pour lire et écrire l'espace mémoire partagé.
 
@@ -48,8 +101,20 @@ extern "C"
         uint32_t hauteur;
         uint32_t canaux; // Nombre de canaux (1 = niveaux de gris, 3 = BGR)
         uint32_t fps;
+        uint32_t format; // FORMAT_* (FORMAT_AUTO : déduit de canaux)
     };
 
+    // Un plan d'une image : pour GRAY8 et BGR24, l'image entière; pour I420, trois
+    // plans d'un canal; pour NV12, le plan Y et un plan UV de deux canaux.
+    struct planImage
+    {
+        size_t decalage; // Position du plan dans l'image, en octets
+        uint32_t largeur;
+        uint32_t hauteur;
+        uint32_t canaux; // Octets entrelacés par pixel du plan
+    };
+#define PLANS_MAX 3
+
     // Cette structure permet d'accéder facilement aux diverses informations stockées
     // au début de l'espace partagé
     struct memPartageHeader
@@ -58,6 +123,19 @@ extern "C"
         pthread_cond_t condEcrivain; // Condition sur laquelle l'ecrivain attend
         pthread_cond_t condLecteur;  // Condition sur laquelle le lecteur attend
         volatile uint32_t etat;      // État de synchronisation (voir constantes ETAT_*)
+        uint32_t modeSync;           // Mode de synchronisation (voir constantes MODE_SYNC_*)
+        volatile uint32_t enAttente; // Nombre de processus endormis sur etat (modes FUTEX*, attenteLecteurMultiple)
+        volatile uint32_t verrouPI;  // Mot futex PI : TID du détenteur ou 0 (mode FUTEX_PI)
+        uint32_t tailleDonnees;      // Taille de la zone de données (après le header), en octets
+        uint32_t politique;          // Politique de l'écrivain (voir constantes POLITIQUE_*)
+        volatile uint32_t tripleEchange; // POLITIQUE_DERNIERE : case du milieu + bit « fraîche »
+        volatile uint32_t tramesPerdues; // POLITIQUE_DERNIERE : images écrasées sans être lues
+        uint32_t nbLecteurs;         // Nombre de lecteurs attendus (1 sauf en diffusion)
+        volatile uint32_t inscrits;  // Diffusion : un bit par lecteur inscrit
+        volatile uint32_t lecteursEtat; // Diffusion : bits « à lire » (0-7) et « en lecture » (8-15)
+        volatile uint32_t sautees[LECTEURS_MAX]; // Diffusion : images sautées par chaque lecteur
+        volatile uint32_t tramesSauteesAmont; // Images sautées à la source (décodeur en retard),
+                                              // recopié d'étape en étape par propagerSautees
         struct videoInfos infos;     // Informations sur la vidéo
     };
 
@@ -70,7 +148,55 @@ extern "C"
         struct memPartageHeader *header; // Pointeur vers le header dans la mémoire partagée
         size_t tailleDonnees;            // Taille de la zone de données (après le header)
         unsigned char *data;             // Pointeur vers la zone de données (après le header)
+                                         // (en POLITIQUE_DERNIERE, vers la case détenue par ce processus)
+        uint32_t caseLocale;             // POLITIQUE_DERNIERE : case détenue par ce processus
+        int32_t indiceLecteur;           // Diffusion : indice du lecteur (-1 pour l'écrivain)
+        uint32_t attenteActiveNs;        // Budget courant d'attente active (ajusté à chaque attente)
+        uint32_t attenteActiveMaxNs;     // Budget maximal (0 = attente active désactivée)
+    };
+
+    // Options appliquées aux zones initialisées par ce processus. modeSync et politique ne
+    // concernent que les zones créées (écrivain); l'attente active s'applique aux deux côtés.
+    struct optionsCanal
+    {
+        uint32_t modeSync;           // MODE_SYNC_* (PTHREAD par défaut)
+        uint32_t politique;          // POLITIQUE_* (BLOQUANTE par défaut)
+        uint32_t nbLecteurs;         // Nombre de lecteurs (1 par défaut, jusqu'à LECTEURS_MAX)
+        uint32_t attenteActiveMaxNs; // Budget maximal d'attente active, en ns
     };
+    extern struct optionsCanal optionsCanalDefaut;
+
+    // Parse l'argument de l'option -m (mode de synchronisation : PTHREAD, FUTEX, FUTEX_PI)
+    // et l'inscrit dans optionsCanalDefaut. Retourne 0 en cas de succès, -1 si le mode
+    // n'est pas reconnu (PTHREAD est alors utilisé).
+    int parseModeSync(const char *arg);
+
+    // Parse l'argument de l'option -p (politique de l'écrivain : BLOQUANTE, DERNIERE)
+    // et l'inscrit dans optionsCanalDefaut. Retourne 0 en cas de succès, -1 sinon.
+    int parsePolitique(const char *arg);
+
+    // Parse l'argument de l'option -n (nombre de lecteurs des zones créées, 1 à LECTEURS_MAX)
+    // et l'inscrit dans optionsCanalDefaut. Retourne 0 en cas de succès, -1 sinon.
+    int parseNbLecteurs(const char *arg);
+
+    // Parse l'argument de l'option -b (budget maximal d'attente active, en nanosecondes)
+    // et l'inscrit dans optionsCanalDefaut. Retourne 0 en cas de succès, -1 sinon.
+    int parseAttenteActive(const char *arg);
+
+    // Format effectif (jamais FORMAT_AUTO) d'une image décrite par infos
+    uint32_t formatVideo(const struct videoInfos *infos);
+
+    // Nombre d'octets d'une image décrite par infos, selon son format
+    size_t tailleImageVideo(const struct videoInfos *infos);
+
+    // Décrit les plans d'une image de largeur x hauteur au format donné. Retourne le
+    // nombre de plans remplis dans plans (au plus PLANS_MAX).
+    int plansImage(uint32_t format, uint32_t largeur, uint32_t hauteur,
+                   struct planImage *plans);
+
+    // Interprète un nom de format (GRAY8, BGR24, I420, NV12). Retourne le FORMAT_*
+    // correspondant, ou -1 si le nom n'est pas reconnu.
+    int parseFormat(const char *arg);
 
     // Appelée au début du programme pour l'initialisation de la zone mémoire (cas du lecteur).
     // Reçoit un pointeur vers une structure memPartage _vide_.
@@ -92,6 +218,16 @@ extern "C"
                                     struct memPartage *zone,
                                     struct videoInfos *infos);
 
+    // Variante de initMemoirePartageeEcrivain pour laquelle la taille de la zone de données
+    // est fournie explicitement plutôt que déduite de la struct videoInfos. Utile pour les
+    // canaux qui ne transportent pas directement une image (par exemple, des poignées vers
+    // un pool de trames, voir poolTrames.h). Le lecteur n'a rien de particulier à faire :
+    // initMemoirePartageeLecteur utilise la taille inscrite dans le header.
+    int initMemoirePartageeEcrivainTaille(const char *identifiant,
+                                          struct memPartage *zone,
+                                          struct videoInfos *infos,
+                                          size_t tailleDonnees);
+
     // Appelée par le lecteur pour se mettre en attente de données sur la zone mémoire partagée
     // Lorsque cette fonction retourne, le mutex devrait être verrouillé par le processus en cours!
     int attenteLecteur(struct memPartage *zone);
@@ -104,13 +240,34 @@ extern "C"
     // verrouillé par le processus en cours!
     int attenteLecteurAsync(struct memPartage *zone);
 
+    // Attente de plusieurs zones à la fois (utile au compositeur) : bloque jusqu'à ce qu'au
+    // moins une des nbZones zones contienne des données, ou jusqu'à l'échéance (temps absolu
+    // sur CLOCK_MONOTONIC, NULL pour aucune échéance). Retourne l'indice (dans le tableau
+    // zones) d'une zone prête, ou -1 si l'échéance est atteinte. Contrairement à
+    // attenteLecteur, aucun verrou n'est pris : l'appelant doit ensuite utiliser
+    // attenteLecteurAsync sur la zone retournée.
+    // Repose sur futex_waitv (Linux 5.16+); sur un noyau plus ancien, l'attente se fait
+    // par tranches de DELAI_ATTENTE_MULTIPLE_NS.
+    int attenteLecteurMultiple(struct memPartage **zones, int nbZones,
+                               const struct timespec *echeance);
+
     // Appelée par l'écrivain pour se mettre en attente de la lecture du résultat précédent par un lecteur
     // Lorsque cette fonction retourne, le mutex devrait être verrouillé par le processus en cours!
+    // (En mode FUTEX, il n'y a pas de mutex : c'est la valeur de etat qui donne au processus
+    // l'accès exclusif aux données jusqu'à l'appel de la fonction signal* correspondante.)
     int attenteEcrivain(struct memPartage *zone);
 
     // Appelée par le lecteur pour signaler qu'il a fini de lire (réveille l'écrivain correspondant)
     void signalLecteur(struct memPartage *zone);
 
+    // Recopie dans la zone de sortie d'une étape le nombre d'images sautées en amont de
+    // sa zone d'entrée, pour que le compositeur puisse le rapporter
+    void propagerSautees(const struct memPartage *entree, struct memPartage *sortie);
+
+    // Nombre d'images que ce lecteur n'a jamais reçues (POLITIQUE_DERNIERE) : images sautées
+    // par ce lecteur en diffusion, images écrasées dans le triple tampon sinon
+    uint32_t tramesPerduesLecteur(const struct memPartage *zone);
+
     // Appelée par l'écrivain pour signaler qu'il a fini d'écrire (réveille le lecteur correspondant)
     void signalEcrivain(struct memPartage *zone);
 
@@ -9,10 +9,10 @@
  * Récupère plusieurs flux vidéos à partir d'espaces mémoire partagés et les
  * affiche directement dans le framebuffer de la carte graphique.
  *
- * IMPORTANT : CE CODE ASSUME QUE TOUS LES FLUX QU'IL REÇOIT SONT EN 427x240
- * (427 pixels en largeur, 240 en hauteur). TOUTE AUTRE TAILLE ENTRAINERA UN
- * COMPORTEMENT INDÉFINI. Les flux peuvent comporter 1 ou 3 canaux. Dans ce
- * dernier cas, ils doivent être dans l'ordre BGR et NON RGB.
+ * Jusqu'à MAX_FLUX flux de tailles quelconques sont disposés en grille selon
+ * la résolution de l'écran (voir DISPOSITION). Les flux peuvent être en GRAY8,
+ * en BGR24 (dans l'ordre BGR et NON RGB) ou en YCbCr 4:2:0 (I420, NV12); le
+ * compositeur est la seule étape qui les convertit en BGR.
  *
  * Le code permettant l'affichage est inspiré de celui présenté sur le blog
  * Raspberry Compote
@@ -23,7 +23,10 @@
  * du framebuffer.
  ******************************************************************************/
 
+// Extensions de la libc : préférence d'écriture du verrou des pages (-T)
+#define _GNU_SOURCE
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -57,21 +60,179 @@
 #include <err.h>
 #include <errno.h>
 
-#include "allocateurMemoire.h"
 #include "commMemoirePartagee.h"
+#include "conversionPixels.h"
+#include "histogramme.h"
+#include "mesures.h"
+#include "sortieAffichage.h"
 #include "utils.h"
 
-static unsigned char *g_imageGlobale = NULL;
-static int g_currentPage = 0;
-
-static void flushDisplay(int fbfd, unsigned char *fb, size_t hauteurFB,
-                         struct fb_var_screeninfo *vinfoPtr, int fbLineLength) {
-  g_currentPage = (g_currentPage + 1) % 2;
-  unsigned char *dest = fb + g_currentPage * fbLineLength * hauteurFB;
-  memcpy(dest, g_imageGlobale, fbLineLength * hauteurFB);
-  vinfoPtr->yoffset = g_currentPage * vinfoPtr->yres;
-  vinfoPtr->activate = FB_ACTIVATE_VBL;
-  ioctl(fbfd, FBIOPAN_DISPLAY, vinfoPtr);
+#define MAX_FLUX 16
+
+// Taille d'une case de la mosaïque lorsque la résolution n'est imposée ni
+// par -g ni par le framebuffer (taille des flux produits par le redimensionneur)
+#define LARGEUR_CASE_DEFAUT 427
+#define HAUTEUR_CASE_DEFAUT 240
+
+/******************************************************************************
+ * DISPOSITION
+ * Les flux sont placés dans une grille calculée à partir de la résolution
+ * réelle de la sortie : parmi les nombres de colonnes possibles, on garde
+ * celui qui permet d'afficher les flux le plus grand possible. Chaque flux est
+ * mis à l'échelle (plus proche voisin, proportions conservées) et centré dans
+ * sa case. Les tables colonnesSource/lignesSource sont calculées une seule
+ * fois : la mise à l'échelle se fait pendant l'écriture dans la page, sans
+ * image intermédiaire. Un flux déjà à la bonne taille est copié ligne par
+ * ligne.
+ *
+ * Mosaïque (plus d'un flux) : chaque flux est écrit directement dans sa tuile
+ * de la page cachée. Une tuile écrite dans une page devient périmée dans
+ * l'autre; avant d'afficher la page cachée, flushDisplay y recopie (depuis la
+ * page affichée) les tuiles qui y sont périmées et n'ont pas été réécrites
+ * depuis. Les deux pages restent ainsi identiques hors des tuiles modifiées.
+ *
+ * PRÉSENTATION
+ * Par défaut, chaque flux est lu à sa propre cadence (nextWakeup) et la page
+ * est affichée dès qu'un flux a été écrit : plusieurs changements de page
+ * peuvent tomber dans le même rafraîchissement de l'écran, ou aucun. Avec -V,
+ * la boucle est cadencée par l'écran (attendreRafraichissement) : à chaque
+ * retour vertical, la dernière image prête de chaque flux est écrite, puis la
+ * page est affichée une seule fois. L'écriture commence juste après le retour
+ * vertical, quand la page qui vient d'être cachée n'est plus balayée.
+ ******************************************************************************/
+struct tuile {
+  size_t decalage;         // Position du coin supérieur gauche, en octets
+  uint32_t largeur;        // Taille à l'écran, en pixels
+  uint32_t hauteur;
+  uint32_t largeurSource;  // Taille du flux
+  uint32_t hauteurSource;
+  uint32_t *colonnesSource; // Octet (dans une ligne BGR source) de chaque
+                            // colonne; NULL si le flux n'est pas mis à l'échelle
+  uint32_t *lignesSource;   // Ligne source de chaque ligne de la tuile
+  unsigned char *ligneBGR;     // Ligne source convertie en BGR
+  unsigned char *ligneEchelle; // Ligne mise à l'échelle, en BGR
+};
+static struct tuile g_tuiles[MAX_FLUX];
+static uint32_t g_tuilesPerimees[2]; // Par page, un bit par flux
+
+// Facteur d'échelle qui fait tenir une image largeur x hauteur dans une case
+static double echelleCase(uint32_t largeurCase, uint32_t hauteurCase,
+                          uint32_t largeur, uint32_t hauteur) {
+  double ex = (double)largeurCase / largeur, ey = (double)hauteurCase / hauteur;
+  return (ex < ey) ? ex : ey;
+}
+
+static int initDisposition(int total, const struct sortieAffichage *sortie,
+                           const struct memPartage *zones) {
+  // Nombre de colonnes donnant le plus grand facteur d'échelle pour le flux
+  // le moins bien servi (à égalité, le moins de colonnes)
+  int colonnes = 1;
+  double meilleure = -1.0;
+  for (int c = 1; c <= total; c++) {
+    int r = (total + c - 1) / c;
+    double pire = -1.0;
+    for (int i = 0; i < total; i++) {
+      double e = echelleCase(sortie->largeur / c, sortie->hauteur / r,
+                             zones[i].header->infos.largeur,
+                             zones[i].header->infos.hauteur);
+      if (pire < 0.0 || e < pire)
+        pire = e;
+    }
+    if (pire > meilleure) {
+      meilleure = pire;
+      colonnes = c;
+    }
+  }
+  int rangees = (total + colonnes - 1) / colonnes;
+  uint32_t largeurCase = sortie->largeur / colonnes;
+  uint32_t hauteurCase = sortie->hauteur / rangees;
+
+  for (int i = 0; i < total; i++) {
+    struct tuile *t = &g_tuiles[i];
+    t->largeurSource = zones[i].header->infos.largeur;
+    t->hauteurSource = zones[i].header->infos.hauteur;
+
+    double e = echelleCase(largeurCase, hauteurCase, t->largeurSource,
+                           t->hauteurSource);
+    t->largeur = (uint32_t)(t->largeurSource * e);
+    t->hauteur = (uint32_t)(t->hauteurSource * e);
+    if (t->largeur > largeurCase)
+      t->largeur = largeurCase;
+    if (t->hauteur > hauteurCase)
+      t->hauteur = hauteurCase;
+    if (t->largeur == 0 || t->hauteur == 0) {
+      fprintf(stderr, "[compositeur] Écran trop petit pour %d flux\n", total);
+      return -1;
+    }
+
+    size_t x = (size_t)(i % colonnes) * largeurCase + (largeurCase - t->largeur) / 2;
+    size_t y = (size_t)(i / colonnes) * hauteurCase + (hauteurCase - t->hauteur) / 2;
+    t->decalage = y * sortie->longueurLigne + x * sortie->octetsPixel;
+
+    // Lignes de travail propres à chaque tuile : avec -T, les tuiles sont
+    // écrites en parallèle
+    t->ligneBGR = (unsigned char *)malloc((size_t)t->largeurSource * 3);
+    t->ligneEchelle = (unsigned char *)malloc((size_t)t->largeur * 3);
+    if (t->ligneBGR == NULL || t->ligneEchelle == NULL) {
+      fprintf(stderr, "[compositeur] Erreur d'allocation de la disposition\n");
+      return -1;
+    }
+
+    t->colonnesSource = NULL;
+    t->lignesSource = NULL;
+    if (t->largeur == t->largeurSource && t->hauteur == t->hauteurSource)
+      continue;
+    t->colonnesSource = (uint32_t *)malloc(t->largeur * sizeof(uint32_t));
+    t->lignesSource = (uint32_t *)malloc(t->hauteur * sizeof(uint32_t));
+    if (t->colonnesSource == NULL || t->lignesSource == NULL) {
+      fprintf(stderr, "[compositeur] Erreur d'allocation de la disposition\n");
+      return -1;
+    }
+    for (uint32_t j = 0; j < t->largeur; j++)
+      t->colonnesSource[j] =
+          (uint32_t)(((uint64_t)j * t->largeurSource / t->largeur) * 3);
+    for (uint32_t j = 0; j < t->hauteur; j++)
+      t->lignesSource[j] =
+          (uint32_t)((uint64_t)j * t->hauteurSource / t->hauteur);
+  }
+
+  printf("[compositeur] Écran %ux%u (%u bits par pixel), grille %dx%d\n",
+         sortie->largeur, sortie->hauteur, sortie->octetsPixel * 8, colonnes,
+         rangees);
+  return 0;
+}
+
+static void flushDisplay(struct sortieAffichage *sortie) {
+  int cachee = 1 - sortie->page;
+  size_t fbLineLength = sortie->longueurLigne;
+  unsigned char *dest = pageCachee(sortie);
+  const unsigned char *src = pageAffichee(sortie);
+  for (int i = 0; i < MAX_FLUX; i++) {
+    if (!(g_tuilesPerimees[cachee] & (1u << i)))
+      continue;
+    const struct tuile *t = &g_tuiles[i];
+    for (size_t ligne = 0; ligne < t->hauteur; ligne++) {
+      size_t pos = t->decalage + ligne * fbLineLength;
+      memcpy(dest + pos, src + pos, (size_t)t->largeur * sortie->octetsPixel);
+    }
+  }
+  g_tuilesPerimees[cachee] = 0;
+  presenterPage(sortie);
+}
+
+// Retourne la ligne ligne de l'image source (dans son format) en BGR24 :
+// directement dans data pour une source BGR24, sinon convertie dans tampon
+static const unsigned char *ligneSourceBGR(unsigned char *tampon,
+                                           const unsigned char *data,
+                                           size_t ligne, size_t largeur,
+                                           size_t hauteur, uint32_t format) {
+  if (format == FORMAT_BGR24)
+    return data + ligne * largeur * 3;
+  if (format == FORMAT_GRAY8)
+    convertirLigneGris(data + ligne * largeur, tampon, largeur, 3);
+  else
+    convertYUV420RowToBGR(data, hauteur, largeur, format, ligne, tampon);
+  return tampon;
 }
 
 // Fonction permettant de récupérer le temps courant sous forme double
@@ -82,109 +243,340 @@ double get_time() {
   return (double)t.tv_sec + (double)(t.tv_usec) * 1e-6;
 }
 
-// Cette fonction écrit l'image dans le framebuffer, à la position demandée.
-// Elle est déjà codée pour vous, mais vous devez l'utiliser correctement. En
-// particulier, n'oubliez pas que cette fonction assume que TOUTES LES IMAGES
-// QU'ELLE REÇOIT SONT EN 427x240 (1 ou 3 canaux). Cette fonction peut gérer
-// l'affichage de 1, 2, 3 ou 4 images sur le même écran, en utilisant la
-// séparation préconisée dans l'énoncé. La position (premier argument) doit être
-// un entier inférieur au nombre total d'images à afficher (second argument). Le
-// troisième argument est le descripteur de fichier du framebuffer (nommé fbfb
-// dans la fonction main()). Le quatrième argument est un pointeur sur le memory
-// map de ce framebuffer (nommé fbd dans la fonction main()). Les cinquième et
-// sixième arguments sont la largeur et la hauteur de ce framebuffer. Le
-// septième est une structure contenant l'information sur le framebuffer (nommé
-// vinfo dans la fonction main()). Le huitième est la longueur effective d'une
-// ligne du framebuffer (en octets), contenue dans finfo.line_length dans la
-// fonction main(). Le neuvième argument est le buffer contenant l'image à
-// afficher, et les trois derniers arguments ses dimensions.
-void ecrireImage(const int position, const int total, int fbfd,
-                 unsigned char *fb, size_t largeurFB, size_t hauteurFB,
-                 struct fb_var_screeninfo *vinfoPtr, int fbLineLength,
-                 const unsigned char *data, size_t hauteurSource,
-                 size_t largeurSource, size_t canauxSource) {
-  if (g_imageGlobale == NULL)
-    g_imageGlobale = (unsigned char *)calloc(fbLineLength * hauteurFB, 1);
-  unsigned char *imageGlobale = g_imageGlobale;
-
+// Cette fonction écrit l'image dans la page cachée de la sortie, dans la
+// tuile du flux position (voir DISPOSITION; initDisposition doit avoir été
+// appelée). La position (premier argument) doit être un entier inférieur au
+// nombre total d'images à afficher (second argument). Le troisième argument
+// est la sortie d'affichage (voir sortieAffichage.h). Le quatrième argument
+// est le buffer contenant l'image à afficher et le dernier son format.
+// flushDisplay affiche ensuite la page.
+void ecrireImage(const int position, const int total,
+                 struct sortieAffichage *sortie, const unsigned char *data,
+                 uint32_t formatSource) {
   if (position >= total) {
     return;
   }
 
-  const unsigned char *dataTraite = data;
-  unsigned char *d = NULL;
-  if (canauxSource == 1) {
-    d = (unsigned char *)tempsreel_malloc(largeurSource * hauteurSource * 3);
-    unsigned int pos = 0;
-    for (unsigned int i = 0; i < hauteurSource; ++i) {
-      for (unsigned int j = 0; j < largeurSource; ++j) {
-        d[pos++] = data[i * largeurSource + j];
-        d[pos++] = data[i * largeurSource + j];
-        d[pos++] = data[i * largeurSource + j];
+  const struct tuile *t = &g_tuiles[position];
+  size_t fbLineLength = sortie->longueurLigne;
+  uint32_t octetsPixel = sortie->octetsPixel;
+  int page = 1 - sortie->page;
+  unsigned char *dest = pageCachee(sortie) + t->decalage;
+
+  if (t->colonnesSource == NULL) {
+    for (size_t ligne = 0; ligne < t->hauteur; ligne++) {
+      if (formatSource == FORMAT_GRAY8) {
+        convertirLigneGris(data + ligne * t->largeurSource, dest, t->largeur,
+                           octetsPixel);
+      } else if (octetsPixel == 3 && formatSource != FORMAT_BGR24) {
+        // Conversion directement dans la page
+        ligneSourceBGR(dest, data, ligne, t->largeurSource, t->hauteurSource,
+                       formatSource);
+      } else {
+        convertirLigneBGR(ligneSourceBGR(t->ligneBGR, data, ligne,
+                                         t->largeurSource, t->hauteurSource,
+                                         formatSource),
+                          dest, t->largeur, octetsPixel);
       }
+      dest += fbLineLength;
     }
-    dataTraite = d;
-  }
-
-  if (total == 1) {
-    g_currentPage = (g_currentPage + 1) % 2;
-    unsigned char *currentFramebuffer =
-        fb + g_currentPage * fbLineLength * hauteurFB;
-    for (unsigned int ligne = 0; ligne < hauteurSource; ligne++) {
-      memcpy(currentFramebuffer + ligne * fbLineLength,
-             dataTraite + ligne * largeurSource * 3, largeurFB * 3);
-    }
-  } else if (total == 2) {
-    if (position == 0) {
-      for (unsigned int ligne = 0; ligne < hauteurSource; ligne++) {
-        memcpy(imageGlobale + ligne * fbLineLength,
-               dataTraite + ligne * largeurSource * 3, largeurFB * 3);
+  } else {
+    // Mise à l'échelle au plus proche voisin : chaque ligne source utilisée
+    // est convertie en BGR (une seule fois si elle est répétée), puis
+    // échantillonnée dans la page (BGR24) ou dans une ligne convertie ensuite
+    // au format de la sortie
+    const unsigned char *src = NULL;
+    long derniere = -1;
+    for (size_t ligne = 0; ligne < t->hauteur; ligne++) {
+      uint32_t ls = t->lignesSource[ligne];
+      if ((long)ls != derniere)
+        src = ligneSourceBGR(t->ligneBGR, data, ls, t->largeurSource,
+                             t->hauteurSource, formatSource);
+      derniere = ls;
+      unsigned char *d = (octetsPixel == 3) ? dest : t->ligneEchelle;
+      for (uint32_t j = 0; j < t->largeur; j++) {
+        const unsigned char *p = src + t->colonnesSource[j];
+        d[0] = p[0];
+        d[1] = p[1];
+        d[2] = p[2];
+        d += 3;
       }
-    } else {
-      for (unsigned int ligne = hauteurSource; ligne < hauteurSource * 2;
-           ligne++) {
-        memcpy(imageGlobale + ligne * fbLineLength,
-               dataTraite + (ligne - hauteurSource) * largeurSource * 3,
-               largeurFB * 3);
-      }
-    }
-  } else if (total == 3 || total == 4) {
-    off_t offsetLigne = 0;
-    off_t offsetColonne = 0;
-    switch (position) {
-    case 0:
-      break;
-    case 1:
-      offsetColonne = largeurSource;
-      break;
-    case 2:
-      offsetLigne = hauteurSource;
-      break;
-    case 3:
-      offsetLigne = hauteurSource;
-      offsetColonne = largeurSource;
-      break;
+      if (octetsPixel != 3)
+        convertirLigneBGR(t->ligneEchelle, dest, t->largeur, octetsPixel);
+      dest += fbLineLength;
     }
-    offsetLigne *= fbLineLength;
-    offsetColonne *= 3;
-    for (unsigned int ligne = 0; ligne < hauteurSource; ligne++) {
-      memcpy(imageGlobale + offsetLigne + offsetColonne,
-             dataTraite + ligne * largeurSource * 3, largeurSource * 3);
-      offsetLigne += fbLineLength;
+  }
+
+  // Atomique : avec -T, plusieurs fils écrivent leur tuile en même temps
+  __atomic_and_fetch(&g_tuilesPerimees[page], ~(1u << position),
+                     __ATOMIC_RELAXED);
+  __atomic_or_fetch(&g_tuilesPerimees[1 - page], 1u << position,
+                    __ATOMIC_RELAXED);
+}
+
+/******************************************************************************
+ * STATISTIQUES
+ * Pour chaque flux, les délais entre deux images affichées sont comptés dans
+ * un histogramme (histogramme.h, en microsecondes), vidé à chaque ligne
+ * écrite (toutes les 5 secondes). stats.txt garde le format de l'énoncé
+ * (moy, max) suivi des percentiles p50/p90/p99/p99.9, de la gigue (écart-type
+ * des délais) et du nombre de retards (délais de plus de 1,5 fois la période
+ * du flux). Avec -S fichier, les mêmes valeurs sont aussi écrites en CSV (une
+ * ligne par flux et par intervalle), ou en JSON (un objet par ligne) si le nom
+ * se termine par .json.
+ ******************************************************************************/
+struct statsFlux {
+  struct histogramme delais; // Délais entre deux images affichées (us)
+  uint32_t nbRetards;        // Délais de plus de 1,5 période
+  uint64_t periodeUs;        // Période du flux
+  struct timespec dernierAffichage;
+};
+
+struct fichiersStats {
+  FILE *texte;                  // stats.txt
+  struct sortieMesures machine; // -S : CSV ou JSON
+};
+
+static const char *const colonnesStats[] = {
+    "temps_s", "entree", "images", "fps",     "periode_ms", "max_ms",
+    "p50_ms",  "p90_ms", "p99_ms", "p999_ms", "gigue_ms",   "retards"};
+
+// Note l'affichage d'une image du flux au temps t
+static void noterAffichage(struct statsFlux *st, const struct timespec *t) {
+  int64_t delai_us =
+      (int64_t)(t->tv_sec - st->dernierAffichage.tv_sec) * 1000000 +
+      (t->tv_nsec - st->dernierAffichage.tv_nsec) / 1000;
+  if (delai_us < 0)
+    delai_us = 0;
+  histoAjouter(&st->delais, (uint64_t)delai_us);
+  if ((uint64_t)delai_us * 2 > st->periodeUs * 3)
+    st->nbRetards++;
+  st->dernierAffichage = *t;
+}
+
+// Ajoute une ligne à stats.txt (et au fichier de -S) pour les duree dernières
+// secondes, puis vide les histogrammes
+static void ecrireStats(struct fichiersStats *f, double ecoule, double duree,
+                        int total, struct statsFlux *stats,
+                        struct memPartage *zones,
+                        const struct sortieAffichage *sortie, int modeVsync) {
+  if (f->texte)
+    fprintf(f->texte, "[%.1f] ", ecoule);
+  for (int i = 0; i < total; i++) {
+    const struct histogramme *h = &stats[i].delais;
+    double fps_moy = (duree > 0.0) ? (h->nb / duree) : 0.0;
+    double max = h->max / 1000.0;
+    double p50 = histoPercentile(h, 50.0) / 1000.0;
+    double p90 = histoPercentile(h, 90.0) / 1000.0;
+    double p99 = histoPercentile(h, 99.0) / 1000.0;
+    double p999 = histoPercentile(h, 99.9) / 1000.0;
+    double gigue = histoEcartType(h) / 1000.0;
+
+    if (f->texte) {
+      fprintf(f->texte, "Entree %d: moy=%.1f fps, max=%.1f ms", i + 1,
+              fps_moy, max);
+      fprintf(f->texte,
+              ", p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f ms, gigue=%.1f ms, "
+              "retards=%u",
+              p50, p90, p99, p999, gigue, stats[i].nbRetards);
+      // images écrasées par l'écrivain avant d'avoir été lues (cumulatif)
+      if (zones[i].header->politique == POLITIQUE_DERNIERE)
+        fprintf(f->texte, ", perdues=%u", tramesPerduesLecteur(&zones[i]));
+      // images sautées par le décodeur pour rester à l'heure (cumulatif)
+      if (zones[i].header->tramesSauteesAmont > 0)
+        fprintf(f->texte, ", sautees=%u", zones[i].header->tramesSauteesAmont);
+      fprintf(f->texte, " | ");
     }
+    struct sortieMesures *m = &f->machine;
+    mesureNombre(m, "%.1f", ecoule);
+    mesureNombre(m, "%d", i + 1);
+    mesureNombre(m, "%llu", (unsigned long long)h->nb);
+    mesureNombre(m, "%.2f", fps_moy);
+    mesureNombre(m, "%.3f", stats[i].periodeUs / 1000.0);
+    mesureNombre(m, "%.3f", max);
+    mesureNombre(m, "%.3f", p50);
+    mesureNombre(m, "%.3f", p90);
+    mesureNombre(m, "%.3f", p99);
+    mesureNombre(m, "%.3f", p999);
+    mesureNombre(m, "%.3f", gigue);
+    mesureNombre(m, "%u", stats[i].nbRetards);
+    finLigneMesures(m);
+    histoReinitialiser(&stats[i].delais);
+    stats[i].nbRetards = 0;
   }
+  if (f->texte) {
+    // -V : rafraîchissements passés sans présentation (cumulatif)
+    if (modeVsync)
+      fprintf(f->texte, "Rafraichissements manques: %llu",
+              (unsigned long long)sortie->rafraichissementsManques);
+    fprintf(f->texte, "\n");
+  }
+}
 
-  if (canauxSource == 1)
-    tempsreel_free(d);
+static void ajouterNs(struct timespec *t, long ns) {
+  t->tv_nsec += ns;
+  while (t->tv_nsec >= 1000000000L) {
+    t->tv_nsec -= 1000000000L;
+    t->tv_sec++;
+  }
+}
 
-  if (total == 1) {
-    vinfoPtr->yoffset = g_currentPage * vinfoPtr->yres;
-    vinfoPtr->activate = FB_ACTIVATE_VBL;
-    ioctl(fbfd, FBIOPAN_DISPLAY, vinfoPtr);
+/******************************************************************************
+ * FILS PAR FLUX (option -T)
+ * Chaque flux est lu par son propre fil d'exécution : il attend son image
+ * (attenteLecteur, bloquant), l'écrit dans sa tuile de la page cachée, puis
+ * le signale au fil principal, qui ne fait plus que présenter les pages
+ * (flushDisplay) et écrire stats.txt. Une conversion coûteuse (niveaux de
+ * gris, mise à l'échelle) ne retarde plus que son propre flux, et les flux
+ * sont convertis sur plusieurs coeurs s'il y en a.
+ * Les tuiles sont disjointes : les fils les écrivent en parallèle en prenant
+ * verrouPages en mode partagé. Le fil principal le prend en mode exclusif
+ * pour changer de page, pour qu'aucune tuile ne soit affichée à moitié
+ * écrite; le verrou donne priorité au fil principal, qui n'est donc jamais
+ * affamé par les lecteurs. Avec -V, la page est présentée au plus une fois
+ * par rafraîchissement.
+ * Chaque fil de lecture applique l'ordonnancement demandé (voir
+ * partagerRuntime).
+ ******************************************************************************/
+struct composition {
+  pthread_rwlock_t verrouPages;
+  pthread_mutex_t mutex;       // Protège tuilesModifiees et stats
+  pthread_cond_t condModifiee; // Le fil principal attend une tuile écrite
+  uint32_t tuilesModifiees;    // Un bit par flux écrit depuis le dernier
+                               // changement de page
+  struct sortieAffichage *sortie;
+  struct statsFlux *stats;
+  int total;
+  const struct SchedParams *params;
+};
+
+struct filFlux {
+  struct composition *comp;
+  struct memPartage *zone;
+  int position;
+  long periode_ns;
+};
+
+static void *filLecteur(void *arg) {
+  struct filFlux *f = (struct filFlux *)arg;
+  struct composition *comp = f->comp;
+  int ordonnancementApplique = 0;
+
+  struct timespec prochaine;
+  clock_gettime(CLOCK_MONOTONIC, &prochaine);
+  while (1) {
+    appliquerOrdonnancementFil(comp->params, &ordonnancementApplique,
+                               "compositeur");
+    // Même cadence que la boucle principale : au plus une image par période
+    // du flux, affichée dès qu'elle est prête si elle est en retard
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &prochaine, NULL) ==
+           EINTR)
+      ;
+    attenteLecteur(f->zone);
+
+    pthread_rwlock_rdlock(&comp->verrouPages);
+    ecrireImage(f->position, comp->total, comp->sortie, f->zone->data,
+                formatVideo(&f->zone->header->infos));
+    pthread_rwlock_unlock(&comp->verrouPages);
+    signalLecteur(f->zone);
+
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    pthread_mutex_lock(&comp->mutex);
+    noterAffichage(&comp->stats[f->position], &t);
+    comp->tuilesModifiees |= 1u << f->position;
+    pthread_cond_signal(&comp->condModifiee);
+    pthread_mutex_unlock(&comp->mutex);
+
+    prochaine = t;
+    ajouterNs(&prochaine, f->periode_ns);
   }
+  return NULL;
 }
 
-#define MAX_FLUX 4
+// Démarre un fil par flux; retourne 0 en cas de succès, -1 sinon
+static int demarrerFils(struct composition *comp, struct filFlux *fils,
+                        struct memPartage *zones, const long *period_ns) {
+  pthread_rwlockattr_t attrVerrou;
+  pthread_rwlockattr_init(&attrVerrou);
+  pthread_rwlockattr_setkind_np(&attrVerrou,
+                                PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+  pthread_rwlock_init(&comp->verrouPages, &attrVerrou);
+  pthread_rwlockattr_destroy(&attrVerrou);
+  pthread_mutex_init(&comp->mutex, NULL);
+  pthread_condattr_t attrCond;
+  pthread_condattr_init(&attrCond);
+  pthread_condattr_setclock(&attrCond, CLOCK_MONOTONIC);
+  pthread_cond_init(&comp->condModifiee, &attrCond);
+  pthread_condattr_destroy(&attrCond);
+  comp->tuilesModifiees = 0;
+
+  for (int i = 0; i < comp->total; i++) {
+    fils[i].comp = comp;
+    fils[i].zone = &zones[i];
+    fils[i].position = i;
+    fils[i].periode_ns = period_ns[i];
+    pthread_t fil;
+    if (pthread_create(&fil, NULL, filLecteur, &fils[i]) != 0) {
+      fprintf(stderr, "[compositeur] Erreur pthread_create\n");
+      return -1;
+    }
+    pthread_detach(fil);
+  }
+  return 0;
+}
+
+// Boucle du fil principal avec -T : présente les pages et écrit stats.txt
+static void boucleFils(struct composition *comp, struct memPartage *zones,
+                       int modeVsync, struct fichiersStats *fstats,
+                       InfosProfilage *profInfos) {
+  struct timespec temps_debut;
+  clock_gettime(CLOCK_MONOTONIC, &temps_debut);
+  struct timespec last_dump = temps_debut;
+
+  while (1) {
+    evenementProfilage(profInfos, ETAT_ENPAUSE);
+    if (modeVsync) {
+      attendreRafraichissement(comp->sortie);
+    } else {
+      // au plus une seconde, pour que les stats soient écrites même si plus
+      // aucun flux n'avance
+      struct timespec echeance;
+      clock_gettime(CLOCK_MONOTONIC, &echeance);
+      echeance.tv_sec++;
+      pthread_mutex_lock(&comp->mutex);
+      while (comp->tuilesModifiees == 0 &&
+             pthread_cond_timedwait(&comp->condModifiee, &comp->mutex,
+                                    &echeance) != ETIMEDOUT)
+        ;
+      pthread_mutex_unlock(&comp->mutex);
+    }
+
+    evenementProfilage(profInfos, ETAT_TRAITEMENT);
+    pthread_rwlock_wrlock(&comp->verrouPages);
+    pthread_mutex_lock(&comp->mutex);
+    uint32_t modifiees = comp->tuilesModifiees;
+    comp->tuilesModifiees = 0;
+    pthread_mutex_unlock(&comp->mutex);
+    if (modifiees)
+      flushDisplay(comp->sortie);
+    pthread_rwlock_unlock(&comp->verrouPages);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed_dump = (now.tv_sec - last_dump.tv_sec) +
+                          (now.tv_nsec - last_dump.tv_nsec) * 1e-9;
+    if (elapsed_dump >= 5.0) {
+      double elapsed_total = (now.tv_sec - temps_debut.tv_sec) +
+                             (now.tv_nsec - temps_debut.tv_nsec) * 1e-9;
+      pthread_mutex_lock(&comp->mutex);
+      ecrireStats(fstats, elapsed_total, elapsed_dump, comp->total,
+                  comp->stats, zones, comp->sortie, modeVsync);
+      pthread_mutex_unlock(&comp->mutex);
+      last_dump = now;
+    }
+  }
+}
 
 int main(int argc, char *argv[]) {
   int nbrActifs = 0; // Sera initialisé par parseArgs ci-dessous
@@ -194,12 +586,8 @@ int main(int argc, char *argv[]) {
   setbuf(stdout, NULL);
 
   // Initialise le profilage
-  char signatureProfilage[128] = {0};
-  char *nomProgramme = (argv[0][0] == '.') ? argv[0] + 2 : argv[0];
-  snprintf(signatureProfilage, 128, "profilage-%s-%u.txt", nomProgramme,
-           (unsigned int)getpid());
   InfosProfilage profInfos;
-  initProfilage(&profInfos, signatureProfilage);
+  initProfilage(&profInfos, argv[0]);
 
   evenementProfilage(&profInfos, ETAT_INITIALISATION);
 
@@ -210,10 +598,59 @@ int main(int argc, char *argv[]) {
       .period = 0,
   };
 
-  char *files[5] = {
+  char *files[MAX_FLUX + 1] = {
       "", "", "", "", NULL,
   };
-  nbrActifs = (int)parseArgs(argc, argv, &params, files);
+  uint32_t largeurEcran = 0, hauteurEcran = 0;
+  uint32_t bitsParPixel = 0; // 0 : profondeur native de la sortie
+  int modeVsync = 0;         // -V : une présentation par rafraîchissement
+  int modeFils = 0;          // -T : un fil d'exécution par flux
+  const char *nomStatsMachine = NULL; // -S : statistiques en CSV ou JSON
+  struct sortieAffichage sortie;
+  parseSortie("fb", &sortie);
+  if (argc == 2 && strcmp(argv[1], "--debug") == 0) {
+    nbrActifs = (int)parseArgs(argc, argv, &params, files);
+  } else {
+    int c;
+    opterr = 0;
+    while ((c = getopt(argc, argv, OPTIONS_COMMUNES "o:g:P:VTS:")) != -1) {
+      switch (c) {
+      case 'S':
+        nomStatsMachine = optarg;
+        break;
+      case 'T':
+        modeFils = 1;
+        break;
+      case 'V':
+        modeVsync = 1;
+        break;
+      case 'P':
+        bitsParPixel = (uint32_t)atoi(optarg);
+        break;
+      case 'g':
+        if (sscanf(optarg, "%ux%u", &largeurEcran, &hauteurEcran) != 2) {
+          printf("Resolution %s non valide (LxH), defaut selon les flux\n",
+                 optarg);
+          largeurEcran = hauteurEcran = 0;
+        }
+        break;
+      case 'o':
+        if (parseSortie(optarg, &sortie) != 0) {
+          printf("Sortie %s non valide (fb, null, fichier:prefixe[:N]), "
+                 "defaut sur fb\n",
+                 optarg);
+          parseSortie("fb", &sortie);
+        }
+        break;
+      default:
+        parseOptionCommune(c, optarg, &params);
+        break;
+      }
+    }
+    nbrActifs = argc - optind;
+    for (int i = 0; i < nbrActifs && i < MAX_FLUX; i++)
+      files[i] = argv[optind + i];
+  }
   if (nbrActifs < 1 || nbrActifs > MAX_FLUX) {
     fprintf(stderr,
             "[compositeur] Nombre de flux invalide: %d (attendu: 1-%d)\n",
@@ -242,94 +679,106 @@ int main(int argc, char *argv[]) {
     nextWakeup[i].tv_nsec = 0;
   }
 
-  prepareMemoire(427 * 240 * 3, 427 * 240 * 3);
   struct rlimit rl = {RLIM_INFINITY, RLIM_INFINITY};
   setrlimit(RLIMIT_MEMLOCK, &rl);
   mlockall(MCL_CURRENT | MCL_FUTURE);
-  appliquerOrdonnancement(&params, "compositeur");
 
-  FILE *fstats = fopen("stats.txt", "w");
-  if (fstats)
-    setbuf(fstats, NULL);
+  struct fichiersStats fstats;
+  fstats.texte = fopen("stats.txt", "w");
+  if (fstats.texte)
+    setbuf(fstats.texte, NULL);
+  if (ouvrirSortieMesures(&fstats.machine, nomStatsMachine, colonnesStats,
+                          (int)(sizeof(colonnesStats) / sizeof(colonnesStats[0])),
+                          "compositeur") != 0)
+    return -1;
 
-  int stat_count[MAX_FLUX];
-  double stat_max_delai_ms[MAX_FLUX];
-  struct timespec stat_last_display[MAX_FLUX];
-  memset(stat_count, 0, sizeof(stat_count));
-  memset(stat_max_delai_ms, 0, sizeof(stat_max_delai_ms));
+  struct statsFlux stats[MAX_FLUX];
+  memset(stats, 0, sizeof(stats));
 
   struct timespec temps_debut;
   clock_gettime(CLOCK_MONOTONIC, &temps_debut);
   struct timespec last_dump = temps_debut;
-  for (int i = 0; i < nbrActifs; i++)
-    stat_last_display[i] = temps_debut;
-
-  long int screensize = 0;
-  int fbfd = open("/dev/fb0", O_RDWR);
-  if (fbfd == -1) {
-    perror("Erreur lors de l'ouverture du framebuffer ");
-    return -1;
+  for (int i = 0; i < nbrActifs; i++) {
+    stats[i].dernierAffichage = temps_debut;
+    stats[i].periodeUs = (uint64_t)(period_ns[i] / 1000);
   }
 
-  struct fb_var_screeninfo vinfo;
-  struct fb_var_screeninfo orig_vinfo;
-  struct fb_fix_screeninfo finfo;
-  if (ioctl(fbfd, FBIOGET_VSCREENINFO, &vinfo)) {
-    perror("Erreur lors de la requete d'informations sur le framebuffer ");
+  // Sans -g : une case par flux, à la taille du plus grand flux (1 flux : 1x1,
+  // 2 flux : 1x2, 3-4 flux : 2x2, au-delà : grille presque carrée). Au-delà de
+  // 4 flux sur un framebuffer, sa résolution actuelle est conservée.
+  if (largeurEcran == 0 || hauteurEcran == 0) {
+    uint32_t largeurCase = 0, hauteurCase = 0;
+    for (int i = 0; i < nbrActifs; i++) {
+      if (zones[i].header->infos.largeur > largeurCase)
+        largeurCase = zones[i].header->infos.largeur;
+      if (zones[i].header->infos.hauteur > hauteurCase)
+        hauteurCase = zones[i].header->infos.hauteur;
+    }
+    if (largeurCase == 0 || hauteurCase == 0) {
+      largeurCase = LARGEUR_CASE_DEFAUT;
+      hauteurCase = HAUTEUR_CASE_DEFAUT;
+    }
+    int colonnes = (nbrActifs <= 2) ? 1 : 2;
+    if (nbrActifs > 4) {
+      while (colonnes * colonnes < nbrActifs)
+        colonnes++;
+    }
+    int rangees = (nbrActifs + colonnes - 1) / colonnes;
+    if (nbrActifs <= 4 || sortie.type != SORTIE_FB) {
+      largeurEcran = largeurCase * colonnes;
+      hauteurEcran = hauteurCase * rangees;
+    }
   }
 
-  memcpy(&orig_vinfo, &vinfo, sizeof(struct fb_var_screeninfo));
-
-  vinfo.bits_per_pixel = 24;
-  switch (nbrActifs) {
-  case 1:
-    vinfo.xres = 427;
-    vinfo.yres = 240;
-    break;
-  case 2:
-    vinfo.xres = 427;
-    vinfo.yres = 480;
-    break;
-  case 3:
-  case 4:
-    vinfo.xres = 854;
-    vinfo.yres = 480;
-    break;
-  default:
-    printf("Nombre de sources invalide!\n");
+  if (ouvrirSortie(&sortie, largeurEcran, hauteurEcran, bitsParPixel) != 0)
     return -1;
-    break;
-  }
-
-  vinfo.xres_virtual = vinfo.xres;
-  vinfo.yres_virtual = vinfo.yres * 2;
-  if (ioctl(fbfd, FBIOPUT_VSCREENINFO, &vinfo)) {
-    perror("Erreur lors de l'appel a ioctl ");
-  }
-
-  if (ioctl(fbfd, FBIOGET_FSCREENINFO, &finfo)) {
-    perror("Erreur lors de l'appel a ioctl (2) ");
+  if (initDisposition(nbrActifs, &sortie, zones) != 0)
+    return -1;
+  if (modeVsync) {
+    double hz = initRafraichissement(&sortie);
+    printf("[compositeur] Présentation au rafraîchissement : %.2f Hz (%s)\n",
+           hz, sortie.vsyncMateriel ? "FBIO_WAITFORVSYNC" : "minuterie");
   }
 
-  screensize = finfo.line_length * vinfo.yres * 2;
-  if (finfo.smem_len > 0)
-    screensize = finfo.smem_len;
-  unsigned char *fbp = (unsigned char *)mmap(
-      0, screensize, PROT_READ | PROT_WRITE, MAP_SHARED, fbfd, 0);
-  if (fbp == MAP_FAILED) {
-    perror("Erreur lors du mmap de l'affichage ");
-    return -1;
+  // -d auto : la calibration se fait à la cadence du flux le plus rapide
+  uint32_t fpsMax = (uint32_t)(1000000000L / minPeriod_ns);
+
+  if (modeFils) {
+    static struct composition comp;
+    static struct filFlux fils[MAX_FLUX];
+    static struct SchedParams paramsFils;
+    comp.sortie = &sortie;
+    comp.stats = stats;
+    comp.total = nbrActifs;
+    partagerRuntime(&params, nbrActifs, "compositeur");
+    paramsFils = params;
+    comp.params = &paramsFils;
+    printf("[compositeur] Un fil de lecture par flux\n");
+    if (demarrerFils(&comp, fils, zones, period_ns) != 0)
+      return -1;
+    initCalibration(&profInfos, &params, fpsMax, "compositeur");
+    calibrerAvecFils(&profInfos, &paramsFils, nbrActifs);
+    appliquerOrdonnancement(&params, "compositeur");
+    boucleFils(&comp, zones, modeVsync, &fstats, &profInfos);
   }
+  initCalibration(&profInfos, &params, fpsMax, "compositeur");
+  appliquerOrdonnancement(&params, "compositeur");
 
   while (1) {
+    if (modeVsync) {
+      evenementProfilage(&profInfos, ETAT_ENPAUSE);
+      attendreRafraichissement(&sortie);
+    }
     struct timespec now;
     clock_gettime(CLOCK_MONOTONIC, &now);
     // for group flush
     int displayed_any = 0;
 
-    // if some frames are late then we need a smaller sleep time to ensure we
-    // display it as fast as possible without being blocking
-    int any_overdue = 0;
+    // streams that are due (or never displayed) but have no frame yet. we
+    // block on all of them at once below, so a late frame is displayed as
+    // soon as its writer publishes it
+    struct memPartage *attendus[MAX_FLUX];
+    int nbAttendus = 0;
 
     struct timespec nearest;
     int nearest_set = 0;
@@ -343,25 +792,18 @@ int main(int argc, char *argv[]) {
           (long long)(nextWakeup[i].tv_sec - now.tv_sec) * 1000000000LL +
           (nextWakeup[i].tv_nsec - now.tv_nsec);
 
-      if (!(diff_ns > 0 && initialise[i])) {
+      // avec -V, chaque flux est consulté à chaque rafraîchissement
+      if (modeVsync || !(diff_ns > 0 && initialise[i])) {
         if (attenteLecteurAsync(&zones[i])) {
           evenementProfilage(&profInfos, ETAT_TRAITEMENT);
-          ecrireImage(
-              i, nbrActifs, fbfd, fbp, vinfo.xres, vinfo.yres, &vinfo,
-              finfo.line_length, zones[i].data, zones[i].header->infos.hauteur,
-              zones[i].header->infos.largeur, zones[i].header->infos.canaux);
+          ecrireImage(i, nbrActifs, &sortie, zones[i].data,
+                      formatVideo(&zones[i].header->infos));
           signalLecteur(&zones[i]);
           displayed_any = 1;
 
           struct timespec t_now;
           clock_gettime(CLOCK_MONOTONIC, &t_now);
-          double delai_ms =
-              (t_now.tv_sec - stat_last_display[i].tv_sec) * 1000.0 +
-              (t_now.tv_nsec - stat_last_display[i].tv_nsec) * 1e-6;
-          if (delai_ms > stat_max_delai_ms[i])
-            stat_max_delai_ms[i] = delai_ms;
-          stat_last_display[i] = t_now;
-          stat_count[i]++;
+          noterAffichage(&stats[i], &t_now);
 
           if (!initialise[i])
             initialise[i] = 1;
@@ -372,8 +814,9 @@ int main(int argc, char *argv[]) {
             nextWakeup[i].tv_nsec -= 1000000000L;
             nextWakeup[i].tv_sec++;
           }
-        } else if (initialise[i]) {
-          any_overdue = 1;
+        } else {
+          attendus[nbAttendus++] = &zones[i];
+          continue;
         }
       }
 
@@ -388,66 +831,52 @@ int main(int argc, char *argv[]) {
     }
 
     // stats dump
-    if (fstats) {
+    double elapsed_dump = (now.tv_sec - last_dump.tv_sec) +
+                          (now.tv_nsec - last_dump.tv_nsec) * 1e-9;
+    if (elapsed_dump >= 5.0) {
       double elapsed_total = (now.tv_sec - temps_debut.tv_sec) +
                              (now.tv_nsec - temps_debut.tv_nsec) * 1e-9;
-      double elapsed_dump = (now.tv_sec - last_dump.tv_sec) +
-                            (now.tv_nsec - last_dump.tv_nsec) * 1e-9;
-      if (elapsed_dump >= 5.0) {
-        fprintf(fstats, "[%.1f] ", elapsed_total);
-        for (int i = 0; i < nbrActifs; i++) {
-          double fps_moy =
-              (elapsed_dump > 0.0) ? (stat_count[i] / elapsed_dump) : 0.0;
-          fprintf(fstats, "Entree %d: moy=%.1f fps, max=%.1f ms | ", i + 1,
-                  fps_moy, stat_max_delai_ms[i]);
-          stat_count[i] = 0;
-          stat_max_delai_ms[i] = 0.0;
-        }
-        fprintf(fstats, "\n");
-        last_dump = now;
-      }
+      ecrireStats(&fstats, elapsed_total, elapsed_dump, nbrActifs, stats,
+                  zones, &sortie, modeVsync);
+      last_dump = now;
     }
 
-    if (displayed_any && nbrActifs > 1)
-      flushDisplay(fbfd, fbp, vinfo.yres, &vinfo, finfo.line_length);
-
-    long long sleep_ns = 0;
-    if (nearest_set) {
-      struct timespec now_sleep;
-      clock_gettime(CLOCK_MONOTONIC, &now_sleep);
-      long long diff_ns =
-          (long long)(nearest.tv_sec - now_sleep.tv_sec) * 1000000000LL +
-          (nearest.tv_nsec - now_sleep.tv_nsec);
-      if (diff_ns > 0)
-        sleep_ns = diff_ns;
+    if (displayed_any)
+      flushDisplay(&sortie);
+
+    // -V : la prochaine itération attend le rafraîchissement suivant
+    if (modeVsync)
+      continue;
+
+    // wake up for the next stream deadline, or at most one period from now
+    // so the stats keep being dumped
+    struct timespec echeance;
+    clock_gettime(CLOCK_MONOTONIC, &echeance);
+    struct timespec now_sleep = echeance;
+    echeance.tv_nsec += minPeriod_ns;
+    while (echeance.tv_nsec >= 1000000000L) {
+      echeance.tv_nsec -= 1000000000L;
+      echeance.tv_sec++;
     }
+    if (nearest_set && (nearest.tv_sec < echeance.tv_sec ||
+                        (nearest.tv_sec == echeance.tv_sec &&
+                         nearest.tv_nsec < echeance.tv_nsec)))
+      echeance = nearest;
 
-    if (any_overdue) {
-      long long small = minPeriod_ns / 10;
-      if (sleep_ns == 0 || small < sleep_ns)
-        sleep_ns = small;
-    }
+    long long diff_ns =
+        (long long)(echeance.tv_sec - now_sleep.tv_sec) * 1000000000LL +
+        (echeance.tv_nsec - now_sleep.tv_nsec);
 
-    if (sleep_ns > 0) {
-      if (sleep_ns > minPeriod_ns)
-        sleep_ns = minPeriod_ns;
-      struct timespec sleep_ts;
-      sleep_ts.tv_sec = 0;
-      sleep_ts.tv_nsec = sleep_ns;
+    if (diff_ns > 0) {
       evenementProfilage(&profInfos, ETAT_ENPAUSE);
-      nanosleep(&sleep_ts, NULL);
+      attenteLecteurMultiple(attendus, nbAttendus, &echeance);
     } else if (displayed_any &&
                params.modeOrdonnanceur == ORDONNANCEMENT_DEADLINE) {
       sched_yield();
     }
   }
 
-  munmap(fbp, screensize);
-
-  if (ioctl(fbfd, FBIOPUT_VSCREENINFO, &orig_vinfo)) {
-    printf("Error re-setting variable information.\n");
-  }
-  close(fbfd);
+  fermerSortie(&sortie);
 
   return 0;
 }
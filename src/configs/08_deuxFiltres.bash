@@ -6,25 +6,24 @@
 
 sudo rm /dev/shm/mem*           # On retire les identifiants des zones mémoire partagées des précédentes exécutions
 echo "[Script] 08_deuxFiltres"
-echo "[Script] Lancement decodeurs"
+echo "[Script] Lancement decodeur"
 sudo ./decodeur 160p/02_Sintel.ulv /mem1 &
-sudo ./decodeur 160p/02_Sintel.ulv /mem5 &
-echo "[Script] En attente de creation de /mem1 et /mem5"
-while [ ! -f /dev/shm/mem1 ] || [ ! -f /dev/shm/mem5 ]
+echo "[Script] En attente de creation de /mem1"
+while [ ! -f /dev/shm/mem1 ]
 do
     sleep 0.05
 done
-echo "[Script] /mem1 et /mem5 crees, lancement convertisseur niveau de gris"
-sudo ./convertisseur /mem1 /mem2 &
-sudo ./convertisseur /mem5 /mem6 &
-echo "[Script] En attente de creation de /mem2 et /mem6"
-while [ ! -f /dev/shm/mem2 ] || [ ! -f /dev/shm/mem6 ]
+echo "[Script] /mem1 cree, lancement convertisseur niveau de gris"
+# Une seule conversion, diffusee aux deux filtreurs (-n 2)
+sudo ./convertisseur -n 2 /mem1 /mem2 &
+echo "[Script] En attente de creation de /mem2"
+while [ ! -f /dev/shm/mem2 ]
 do
     sleep 0.05
 done
-echo "[Script] /mem2 et /mem6 crees, lancement filtreur"
+echo "[Script] /mem2 cree, lancement filtreur"
 sudo ./filtreur -f 0 /mem2 /mem3 &
-sudo ./filtreur -f 1 /mem6 /mem7 &
+sudo ./filtreur -f 1 /mem2 /mem7 &
 echo "[Script] En attente de creation de /mem3 et /mem7"
 while [ ! -f /dev/shm/mem3 ] || [ ! -f /dev/shm/mem7 ]
 do
@@ -0,0 +1,139 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier implémentant les conversions de lignes de pixels vers le format
+ * natif de l'affichage
+ ******************************************************************************/
+
+#include "conversionPixels.h"
+
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static inline uint16_t pixel565(unsigned char b, unsigned char g,
+                                unsigned char r) {
+  return (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+/* -------------------------------------------------------------------------- *
+ *  convertirLigneBGR
+ * -------------------------------------------------------------------------- */
+void convertirLigneBGR(const unsigned char *src, unsigned char *dest,
+                       uint32_t n, uint32_t octetsPixel) {
+  uint32_t i = 0;
+
+  if (octetsPixel == 3) {
+    memcpy(dest, src, (size_t)n * 3);
+  } else if (octetsPixel == 4) {
+#if defined(__ARM_NEON)
+    for (; i + 16 <= n; i += 16) {
+      uint8x16x3_t bgr = vld3q_u8(src + i * 3);
+      uint8x16x4_t bgrx;
+      bgrx.val[0] = bgr.val[0];
+      bgrx.val[1] = bgr.val[1];
+      bgrx.val[2] = bgr.val[2];
+      bgrx.val[3] = vdupq_n_u8(0xFF);
+      vst4q_u8(dest + i * 4, bgrx);
+    }
+#endif
+    for (; i < n; i++) {
+      const unsigned char *p = src + i * 3;
+      uint32_t mot = 0xFF000000u | ((uint32_t)p[2] << 16) |
+                     ((uint32_t)p[1] << 8) | p[0];
+      memcpy(dest + i * 4, &mot, 4);
+    }
+  } else if (octetsPixel == 2) {
+#if defined(__ARM_NEON)
+    // Rouge et vert décalés dans l'octet de poids fort, puis insertion à
+    // droite (vsri) des 6 bits de vert et des 5 bits de bleu
+    for (; i + 8 <= n; i += 8) {
+      uint8x8x3_t bgr = vld3_u8(src + i * 3);
+      uint16x8_t p = vshll_n_u8(bgr.val[2], 8);
+      p = vsriq_n_u16(p, vshll_n_u8(bgr.val[1], 8), 5);
+      p = vsriq_n_u16(p, vshll_n_u8(bgr.val[0], 8), 11);
+      vst1q_u16((uint16_t *)(void *)(dest + i * 2), p);
+    }
+#endif
+    for (; i < n; i++) {
+      const unsigned char *p = src + i * 3;
+      uint16_t mot = pixel565(p[0], p[1], p[2]);
+      memcpy(dest + i * 2, &mot, 2);
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- *
+ *  convertirLigneGris
+ * -------------------------------------------------------------------------- */
+void convertirLigneGris(const unsigned char *src, unsigned char *dest,
+                        uint32_t n, uint32_t octetsPixel) {
+  uint32_t i = 0;
+
+  if (octetsPixel == 3) {
+#if defined(__ARM_NEON)
+    for (; i + 16 <= n; i += 16) {
+      uint8x16_t g = vld1q_u8(src + i);
+      uint8x16x3_t bgr = {{g, g, g}};
+      vst3q_u8(dest + i * 3, bgr);
+    }
+#endif
+    for (; i < n; i++) {
+      dest[i * 3 + 0] = src[i];
+      dest[i * 3 + 1] = src[i];
+      dest[i * 3 + 2] = src[i];
+    }
+  } else if (octetsPixel == 4) {
+#if defined(__ARM_NEON)
+    for (; i + 16 <= n; i += 16) {
+      uint8x16_t g = vld1q_u8(src + i);
+      uint8x16x4_t bgrx = {{g, g, g, vdupq_n_u8(0xFF)}};
+      vst4q_u8(dest + i * 4, bgrx);
+    }
+#endif
+    for (; i < n; i++) {
+      uint32_t mot = 0xFF000000u | (src[i] * 0x010101u);
+      memcpy(dest + i * 4, &mot, 4);
+    }
+  } else if (octetsPixel == 2) {
+#if defined(__ARM_NEON)
+    for (; i + 8 <= n; i += 8) {
+      uint16x8_t g = vshll_n_u8(vld1_u8(src + i), 8);
+      uint16x8_t p = vsriq_n_u16(g, g, 5);
+      p = vsriq_n_u16(p, g, 11);
+      vst1q_u16((uint16_t *)(void *)(dest + i * 2), p);
+    }
+#endif
+    for (; i < n; i++) {
+      uint16_t mot = pixel565(src[i], src[i], src[i]);
+      memcpy(dest + i * 2, &mot, 2);
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- *
+ *  convertirLigneVersRGB
+ * -------------------------------------------------------------------------- */
+void convertirLigneVersRGB(const unsigned char *src, unsigned char *dest,
+                           uint32_t n, uint32_t octetsPixel) {
+  for (uint32_t i = 0; i < n; i++) {
+    unsigned char *d = dest + i * 3;
+    if (octetsPixel == 2) {
+      uint16_t mot;
+      memcpy(&mot, src + i * 2, 2);
+      d[0] = (unsigned char)(((mot >> 11) & 0x1F) << 3);
+      d[1] = (unsigned char)(((mot >> 5) & 0x3F) << 2);
+      d[2] = (unsigned char)((mot & 0x1F) << 3);
+    } else {
+      const unsigned char *p = src + i * octetsPixel;
+      d[0] = p[2];
+      d[1] = p[1];
+      d[2] = p[0];
+    }
+  }
+}
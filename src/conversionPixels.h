@@ -0,0 +1,52 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier de déclaration des fonctions de conversion de lignes de pixels
+ * vers le format natif de l'affichage
+ ******************************************************************************/
+
+#ifndef CONVERSION_PIXELS_H
+#define CONVERSION_PIXELS_H
+
+// Permet de protéger le header lorsqu'il est inclus par un fichier C++
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/******************************************************************************
+ * Formats d'affichage, désignés par leur nombre d'octets par pixel :
+ * 2 : RGB565 (mot de 16 bits, rouge dans les bits de poids fort)
+ * 3 : BGR24 (octets B, G, R)
+ * 4 : XRGB8888 (mot de 32 bits; en mémoire, octets B, G, R, X)
+ * Avec 4 octets par pixel, chaque pixel est une seule écriture alignée de 32
+ * bits; RGB565 demande un tiers de bande passante de moins que BGR24.
+ * Compilées pour NEON (cmake -DCIBLE_ARM=NEON, Pi 2 et suivants), les
+ * conversions traitent 8 ou 16 pixels par itération; pour le Pi Zero (ARMv6
+ * sans NEON, la cible par défaut), une écriture par pixel.
+ ******************************************************************************/
+
+    // Convertit n pixels BGR24 de src vers dest, au format de octetsPixel octets par pixel
+    void convertirLigneBGR(const unsigned char *src, unsigned char *dest, uint32_t n,
+                           uint32_t octetsPixel);
+
+    // Convertit n pixels en niveaux de gris (un octet) de src vers dest, au format de
+    // octetsPixel octets par pixel
+    void convertirLigneGris(const unsigned char *src, unsigned char *dest, uint32_t n,
+                            uint32_t octetsPixel);
+
+    // Convertit n pixels au format de octetsPixel octets par pixel vers RGB24 (octets R, G, B),
+    // par exemple pour enregistrer une page affichée
+    void convertirLigneVersRGB(const unsigned char *src, unsigned char *dest, uint32_t n,
+                               uint32_t octetsPixel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -17,12 +17,8 @@
 int main(int argc, char *argv[]) {
   setbuf(stdout, NULL);
 
-  char signatureProfilage[128] = {0};
-  char *nomProgramme = (argv[0][0] == '.') ? argv[0] + 2 : argv[0];
-  snprintf(signatureProfilage, 128, "profilage-%s-%u.txt", nomProgramme,
-           (unsigned int)getpid());
   InfosProfilage profInfos;
-  initProfilage(&profInfos, signatureProfilage);
+  initProfilage(&profInfos, argv[0]);
 
   evenementProfilage(&profInfos, ETAT_INITIALISATION);
 
@@ -41,17 +37,8 @@ int main(int argc, char *argv[]) {
   } else {
     int c;
     opterr = 0;
-    while ((c = getopt(argc, argv, "s:d:")) != -1) {
-      switch (c) {
-      case 's':
-        parseSchedOption(optarg, &params);
-        break;
-      case 'd':
-        parseDeadlineParams(optarg, &params);
-        break;
-      default:
-        break;
-      }
+    while ((c = getopt(argc, argv, OPTIONS_COMMUNES)) != -1) {
+      parseOptionCommune(c, optarg, &params);
     }
     if (argc - optind < 2) {
       fprintf(stderr, "Usage: %s [options] entree sortie\n", argv[0]);
@@ -75,12 +62,14 @@ int main(int argc, char *argv[]) {
   uint32_t haut = zoneEntree.header->infos.hauteur;
   uint32_t canaux = zoneEntree.header->infos.canaux;
   uint32_t fps = zoneEntree.header->infos.fps;
+  uint32_t format = formatVideo(&zoneEntree.header->infos);
 
   struct videoInfos infosOut;
   infosOut.largeur = larg;
   infosOut.hauteur = haut;
   infosOut.canaux = 1;
   infosOut.fps = fps;
+  infosOut.format = FORMAT_GRAY8;
   struct memPartage zoneSortie;
   if (initMemoirePartageeEcrivain(sortie, &zoneSortie, &infosOut) != 0) {
     fprintf(stderr,
@@ -89,13 +78,14 @@ int main(int argc, char *argv[]) {
     return -1;
   }
 
-  size_t tailleEntree = (size_t)larg * haut * canaux;
+  size_t tailleEntree = tailleImageVideo(&zoneEntree.header->infos);
   size_t tailleSortie = (size_t)larg * haut * 1;
 
   prepareMemoire(tailleEntree, tailleSortie);
   struct rlimit rl = {RLIM_INFINITY, RLIM_INFINITY};
   setrlimit(RLIMIT_MEMLOCK, &rl);
   mlockall(MCL_CURRENT | MCL_FUTURE);
+  initCalibration(&profInfos, &params, fps, "convertisseur");
   appliquerOrdonnancement(&params, "convertisseur");
 
   unsigned char *bufEntree =
@@ -117,8 +107,13 @@ int main(int argc, char *argv[]) {
     evenementProfilage(&profInfos, ETAT_TRAITEMENT);
     memcpy(bufEntree, zoneEntree.data, tailleEntree);
     signalLecteur(&zoneEntree);
+    propagerSautees(&zoneEntree, &zoneSortie);
 
-    convertToGray(bufEntree, haut, larg, canaux, bufSortie);
+    // En 4:2:0, le plan Y (en tête de l'image) est déjà l'image en gris
+    if (format == FORMAT_I420 || format == FORMAT_NV12)
+      memcpy(bufSortie, bufEntree, tailleSortie);
+    else
+      convertToGray(bufEntree, haut, larg, canaux, bufSortie);
 
     evenementProfilage(&profInfos, ETAT_ATTENTE_MUTEXECRITURE);
     attenteEcrivain(&zoneSortie);
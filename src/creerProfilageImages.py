@@ -21,6 +21,7 @@ COULEUR_MAPPING = {
     30: "#00B500",
     40: "#f542ef",
     50: "#00CCFF",
+    60: "#9E2AE8",
 }
 COULEUR_MAPPING = {     # Voir https://jfly.uni-koeln.de/color/
     0: "#000000",
@@ -29,6 +30,7 @@ COULEUR_MAPPING = {     # Voir https://jfly.uni-koeln.de/color/
     30: "#009E73",
     40: "#D55E00",
     50: "#56B4E9",
+    60: "#CC79A7",
 }
 NS_TO_MS = 1e6
 
@@ -122,7 +124,7 @@ if __name__ == "__main__":
     ax.legend(
         loc="upper left",
         bbox_to_anchor=(0.03, -0.15),
-        ncol=6,
+        ncol=7,
         handles=[
             Patch(color=COULEUR_MAPPING[0], label="Indefini"),
             Patch(color=COULEUR_MAPPING[10], label="Initialisation"),
@@ -130,6 +132,7 @@ if __name__ == "__main__":
             Patch(color=COULEUR_MAPPING[30], label="Traitement"),
             Patch(color=COULEUR_MAPPING[40], label="Attente ecriture"),
             Patch(color=COULEUR_MAPPING[50], label="En pause"),
+            Patch(color=COULEUR_MAPPING[60], label="Images sautees"),
         ],
     )
 
@@ -8,14 +8,15 @@
  ******************************************************************************/
 
 // Gestion des ressources et permissions
-#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
 #include <sys/mman.h>
 #include <sys/resource.h>
-#include <sys/stat.h>
 #include <time.h>
 
 #include "allocateurMemoire.h"
 #include "commMemoirePartagee.h"
+#include "ulv.h"
 #include "utils.h"
 
 #include "jpgd.h"
@@ -43,15 +44,302 @@ const char header[] = "SETR";
  *suite 4          uint32    0 (indique la fin du fichier)
  ******************************************************************************/
 
+/******************************************************************************
+ * CACHE DES IMAGES DÉCODÉES (option --cache-decoded[=Mo])
+ * Le clip est relu en boucle : après le premier passage, les images décodées
+ * sont servies à partir d'un espace verrouillé en mémoire (mlock) plutôt que
+ * d'être décodées de nouveau. Si le budget ne permet pas de garder toutes les
+ * images, on garde un sous-ensemble réparti uniformément dans le clip. (Une
+ * politique LRU ne donnerait aucun succès : en lecture en boucle, l'image la
+ * moins récemment utilisée est toujours la prochaine demandée.) Chaque image
+ * a donc au plus une case attitrée, et une case n'est jamais réécrite.
+ ******************************************************************************/
+#define CACHE_BUDGET_DEFAUT_MO 64
+
+struct cacheImages {
+  unsigned char *donnees;     // nbCases images de tailleImage octets
+  volatile uint8_t *presente; // 1 lorsque la case contient son image
+  uint32_t nbCases;           // 0 si le cache est désactivé
+  uint32_t nbTrames;
+  size_t tailleImage;
+};
+
+static int initCache(struct cacheImages *cache, uint64_t budgetMo,
+                     uint32_t nbTrames, size_t tailleImage) {
+  memset(cache, 0, sizeof(*cache));
+  // En 64 bits : sur le Pi, un budget de 4 Go ou plus déborde size_t
+  uint64_t budget = (budgetMo > (UINT64_MAX >> 20)) ? UINT64_MAX : budgetMo << 20;
+  uint64_t nbCases = budget / tailleImage;
+  if (nbCases > nbTrames)
+    nbCases = nbTrames;
+  if (nbCases > SIZE_MAX / tailleImage)
+    nbCases = SIZE_MAX / tailleImage;
+  if (nbCases == 0)
+    return 0;
+
+  size_t taille = (size_t)nbCases * tailleImage;
+  void *ptr = mmap(NULL, taille, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if (ptr == MAP_FAILED) {
+    perror("[decodeur] mmap cache");
+    return -1;
+  }
+  if (mlock(ptr, taille) != 0)
+    perror("[decodeur] mlock cache");
+
+  cache->donnees = (unsigned char *)ptr;
+  cache->presente = (volatile uint8_t *)calloc((size_t)nbCases, 1);
+  if (cache->presente == NULL)
+    return -1;
+  cache->nbCases = (uint32_t)nbCases;
+  cache->nbTrames = nbTrames;
+  cache->tailleImage = tailleImage;
+  return 0;
+}
+
+// Case attitrée à l'image indice, ou -1 si elle ne fait pas partie du
+// sous-ensemble gardé en cache
+static long caseCache(const struct cacheImages *cache, uint32_t indice) {
+  if (cache->nbCases == 0)
+    return -1;
+  uint64_t a = (uint64_t)indice * cache->nbCases / cache->nbTrames;
+  uint64_t b = (uint64_t)(indice + 1) * cache->nbCases / cache->nbTrames;
+  return (b > a) ? (long)a : -1;
+}
+
+static const unsigned char *lireCache(const struct cacheImages *cache,
+                                      uint32_t indice) {
+  long c = caseCache(cache, indice);
+  if (c < 0 || !__atomic_load_n(&cache->presente[c], __ATOMIC_ACQUIRE))
+    return NULL;
+  return cache->donnees + (size_t)c * cache->tailleImage;
+}
+
+// Appelée par le fil principal seulement; les décodeurs ne font que lire
+static void ecrireCache(struct cacheImages *cache, uint32_t indice,
+                        const unsigned char *image) {
+  long c = caseCache(cache, indice);
+  if (c < 0 || cache->presente[c])
+    return;
+  memcpy(cache->donnees + (size_t)c * cache->tailleImage, image,
+         cache->tailleImage);
+  __atomic_store_n(&cache->presente[c], 1, __ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+ * FORMAT DE SORTIE (option --format)
+ * jpgd ne fournit que des pixels entrelacés (la conversion YCbCr -> BGR est
+ * faite ligne par ligne à l'intérieur du décodeur) : en I420/NV12, l'image
+ * décodée est donc reconvertie en 4:2:0 avant d'être publiée. Ce coût est payé
+ * une seule fois; toutes les étapes en aval manipulent ensuite 1,5 octet par
+ * pixel au lieu de 3.
+ ******************************************************************************/
+
+// Décode une image JPEG dans le format de la zone de sortie. Retourne un bloc
+// tempsreel_malloc à libérer par l'appelant, ou NULL en cas d'erreur.
+static unsigned char *decoderImage(const unsigned char *trame, uint32_t taille,
+                                   const struct videoInfos *infos) {
+  uint32_t format = formatVideo(infos);
+  int w = 0, h = 0, comps = 0;
+  unsigned char *decoded = jpgd::decompress_jpeg_image_from_memory(
+      trame, (int)taille, &w, &h, &comps, (format == FORMAT_GRAY8) ? 1 : 3);
+  if (decoded == NULL || (format != FORMAT_I420 && format != FORMAT_NV12))
+    return decoded;
+
+  unsigned char *yuv =
+      (unsigned char *)tempsreel_malloc(tailleImageVideo(infos));
+  if (yuv != NULL)
+    convertToYUV420(decoded, infos->hauteur, infos->largeur, format, yuv);
+  tempsreel_free(decoded);
+  return yuv;
+}
+
+/******************************************************************************
+ * DÉCODAGE PARALLÈLE (option -j N)
+ * Les images d'un fichier ULV sont des JPEG indépendants : N fils d'exécution
+ * décodent les images k, k+1, ... en même temps et déposent le résultat dans
+ * une file de réordonnancement de 2N cases (case = numéro % 2N). Le fil
+ * principal publie les images dans l'ordre, au rythme du vidéo (voir CADENCE). Un décodeur
+ * ne prend une nouvelle image que si sa case est libre, ce qui limite l'avance
+ * (et la mémoire utilisée) à 2N images.
+ * Chaque décodeur applique l'ordonnancement demandé (voir partagerRuntime).
+ ******************************************************************************/
+#define DECODEUR_FILS_MAX 8
+
+struct caseDecodee {
+  unsigned char *image;       // Image décodée (tempsreel_malloc), NULL en cas d'erreur
+  const unsigned char *cache; // Image trouvée dans le cache (non décodée), sinon NULL
+  long numero;                // Numéro de l'image contenue, -1 si la case est libre
+};
+
+struct decodageParallele {
+  pthread_mutex_t mutex;
+  pthread_cond_t condTravail;      // Les décodeurs attendent une case libre
+  pthread_cond_t condPret;         // Le fil principal attend l'image suivante
+  const struct fichierULV *fichier;
+  uint64_t premiere;               // Numéro (dans le fichier) de l'image 0
+  long prochaineDistribuee;        // Numéro de la prochaine image à décoder
+  long prochainePubliee;           // Numéro de la prochaine image à publier
+  int nbCases;
+  struct caseDecodee *cases;
+  const struct videoInfos *infos;
+  const struct cacheImages *cache;
+  const struct SchedParams *params;
+};
+
+static void *filDecodage(void *arg) {
+  struct decodageParallele *dp = (struct decodageParallele *)arg;
+  int ordonnancementApplique = 0;
+
+  while (1) {
+    appliquerOrdonnancementFil(dp->params, &ordonnancementApplique, "decodeur");
+    pthread_mutex_lock(&dp->mutex);
+    while (dp->prochaineDistribuee - dp->prochainePubliee >= dp->nbCases)
+      pthread_cond_wait(&dp->condTravail, &dp->mutex);
+    long numero = dp->prochaineDistribuee++;
+    pthread_mutex_unlock(&dp->mutex);
+
+    uint64_t k = dp->premiere + (uint64_t)numero;
+    const unsigned char *enCache =
+        lireCache(dp->cache, (uint32_t)(k % dp->fichier->nbTrames));
+    unsigned char *decoded = NULL;
+    if (enCache == NULL) {
+      uint32_t frameSize;
+      const unsigned char *trame = trameULV(dp->fichier, k, &frameSize);
+      decoded = decoderImage(trame, frameSize, dp->infos);
+    }
+
+    pthread_mutex_lock(&dp->mutex);
+    struct caseDecodee *c = &dp->cases[numero % dp->nbCases];
+    c->image = decoded;
+    c->cache = enCache;
+    c->numero = numero;
+    if (numero == dp->prochainePubliee)
+      pthread_cond_signal(&dp->condPret);
+    pthread_mutex_unlock(&dp->mutex);
+  }
+  return NULL;
+}
+
+// Attend l'image suivante (dans l'ordre du fichier), la copie dans resultat
+// et libère sa case
+static void prochaineImage(struct decodageParallele *dp,
+                           struct caseDecodee *resultat) {
+  pthread_mutex_lock(&dp->mutex);
+  struct caseDecodee *c = &dp->cases[dp->prochainePubliee % dp->nbCases];
+  while (c->numero != dp->prochainePubliee)
+    pthread_cond_wait(&dp->condPret, &dp->mutex);
+  *resultat = *c;
+  c->image = NULL;
+  c->cache = NULL;
+  c->numero = -1;
+  dp->prochainePubliee++;
+  pthread_cond_broadcast(&dp->condTravail);
+  pthread_mutex_unlock(&dp->mutex);
+}
+
+// Abandonne les images jusqu'à (sans l'inclure) l'image jusqua. Les images
+// pas encore distribuées ne sont jamais décodées; celles en cours de
+// décodage sont attendues puis libérées.
+static void sauterImages(struct decodageParallele *dp, long jusqua) {
+  pthread_mutex_lock(&dp->mutex);
+  long fin = jusqua;
+  if (dp->prochaineDistribuee < jusqua) {
+    fin = dp->prochaineDistribuee;
+    dp->prochaineDistribuee = jusqua;
+  }
+  while (dp->prochainePubliee < fin) {
+    struct caseDecodee *c = &dp->cases[dp->prochainePubliee % dp->nbCases];
+    while (c->numero != dp->prochainePubliee)
+      pthread_cond_wait(&dp->condPret, &dp->mutex);
+    tempsreel_free(c->image);
+    c->image = NULL;
+    c->cache = NULL;
+    c->numero = -1;
+    dp->prochainePubliee++;
+  }
+  dp->prochainePubliee = jusqua;
+  pthread_cond_broadcast(&dp->condTravail);
+  pthread_mutex_unlock(&dp->mutex);
+}
+
+/******************************************************************************
+ * CADENCE
+ * L'image n (comptée depuis le début de la lecture) doit être publiée au temps
+ * t0 + n * période, quel que soit le temps passé à décoder ou à attendre le
+ * lecteur. Si le programme a plus d'une période de retard, il saute
+ * directement à l'image qui devrait être affichée maintenant, sans décoder
+ * les images intermédiaires (l'index du fichier ULV le permet en O(1)).
+ ******************************************************************************/
+static int64_t ecartNs(const struct timespec *a, const struct timespec *b) {
+  return (int64_t)(a->tv_sec - b->tv_sec) * 1000000000LL +
+         (a->tv_nsec - b->tv_nsec);
+}
+
+static struct timespec tempsPresentation(const struct timespec *t0, uint64_t n,
+                                         int64_t periode_ns) {
+  int64_t ns = (int64_t)t0->tv_nsec + (int64_t)n * periode_ns;
+  struct timespec t;
+  t.tv_sec = t0->tv_sec + (time_t)(ns / 1000000000LL);
+  t.tv_nsec = (long)(ns % 1000000000LL);
+  return t;
+}
+
+// Retourne le numéro de la prochaine image à publier : n si le programme est
+// à l'heure, sinon l'image qui devrait être affichée maintenant. Les images
+// sautées sont comptées dans le header de la zone.
+static uint64_t rattraperRetard(const struct timespec *t0, uint64_t n,
+                                int64_t periode_ns, struct memPartage *zone,
+                                InfosProfilage *profInfos) {
+  struct timespec maintenant;
+  clock_gettime(CLOCK_MONOTONIC, &maintenant);
+  int64_t ecoule = ecartNs(&maintenant, t0);
+  if (ecoule - (int64_t)n * periode_ns < periode_ns)
+    return n;
+
+  uint64_t cible = (uint64_t)(ecoule / periode_ns);
+  evenementProfilage(profInfos, ETAT_SAUT);
+  __atomic_add_fetch(&zone->header->tramesSauteesAmont, (uint32_t)(cible - n),
+                     __ATOMIC_RELAXED);
+  return cible;
+}
+
+// La zone ne se libère après la première image publiée que lorsque le premier
+// lecteur l'a prise, ce qui peut arriver bien après le lancement du décodeur :
+// la cadence part de ce moment (l'image n, la deuxième publiée, est à l'heure
+// maintenant) plutôt que du lancement. n n'est pas forcément 1 : un premier
+// décodage lent fait sauter des images, une image illisible n'est pas publiée.
+static void ancrerCadence(struct timespec *t0, uint64_t n, int64_t periode_ns) {
+  struct timespec maintenant;
+  clock_gettime(CLOCK_MONOTONIC, &maintenant);
+  int64_t ns = (int64_t)maintenant.tv_nsec - (int64_t)n * periode_ns;
+  t0->tv_sec = maintenant.tv_sec;
+  while (ns < 0) {
+    ns += 1000000000LL;
+    t0->tv_sec--;
+  }
+  t0->tv_nsec = (long)ns;
+}
+
+// Attend (temps absolu) le moment de publier l'image n
+static void attendrePresentation(const struct timespec *t0, uint64_t n,
+                                 int64_t periode_ns, InfosProfilage *profInfos) {
+  struct timespec echeance = tempsPresentation(t0, n, periode_ns);
+  struct timespec maintenant;
+  clock_gettime(CLOCK_MONOTONIC, &maintenant);
+  if (ecartNs(&echeance, &maintenant) <= 0)
+    return;
+  evenementProfilage(profInfos, ETAT_ENPAUSE);
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &echeance, NULL) ==
+         EINTR)
+    ;
+}
+
 int main(int argc, char *argv[]) {
   setbuf(stdout, NULL);
 
-  char signatureProfilage[128] = {0};
-  char *nomProgramme = (argv[0][0] == '.') ? argv[0] + 2 : argv[0];
-  snprintf(signatureProfilage, 128, "profilage-%s-%u.txt", nomProgramme,
-           (unsigned int)getpid());
   InfosProfilage profInfos;
-  initProfilage(&profInfos, signatureProfilage);
+  initProfilage(&profInfos, argv[0]);
 
   evenementProfilage(&profInfos, ETAT_INITIALISATION);
 
@@ -60,71 +348,123 @@ int main(int argc, char *argv[]) {
   params.runtime = 0;
   params.deadline = 0;
   params.period = 0;
+  params.calibration = 0;
+  params.priorite = 0;
+  params.masqueCpu = 0;
 
   char *files[3] = {
       (char *)"240p/02_Sintel.ulv",
       (char *)"/test_decodeur",
       NULL,
   };
-  size_t fileNbr = parseArgs(argc, argv, &params, files);
+  int nbFils = 1;
+  long trameDepart = 0;
+  double tempsDepart = -1.0;
+  long cacheMo = 0;
+  int optionInvalide = 0;
+
+  // Options longues propres au décodeur
+  int format = FORMAT_AUTO;
+  enum {
+    OPTION_START_FRAME = 1000,
+    OPTION_START_TIME,
+    OPTION_CACHE,
+    OPTION_FORMAT
+  };
+  static const struct option optionsLongues[] = {
+      {"start-frame", required_argument, NULL, OPTION_START_FRAME},
+      {"start-time", required_argument, NULL, OPTION_START_TIME},
+      {"cache-decoded", optional_argument, NULL, OPTION_CACHE},
+      {"format", required_argument, NULL, OPTION_FORMAT},
+      {NULL, 0, NULL, 0},
+  };
 
-  if (fileNbr < 2 || files[0] == NULL || files[1] == NULL ||
-      files[0][0] == '\0' || files[1][0] == '\0') {
-    fprintf(stderr, "Usage: %s [options] <fichier.ulv> <identifiant_shm>\n",
-            argv[0]);
-    return -1;
+  if (!(argc == 2 && strcmp(argv[1], "--debug") == 0)) {
+    int c;
+    opterr = 0;
+    while ((c = getopt_long(argc, argv, OPTIONS_COMMUNES "j:", optionsLongues,
+                            NULL)) != -1) {
+      switch (c) {
+      case OPTION_START_FRAME:
+        trameDepart = atol(optarg);
+        break;
+      case OPTION_START_TIME:
+        tempsDepart = atof(optarg);
+        break;
+      case OPTION_CACHE:
+        cacheMo = CACHE_BUDGET_DEFAUT_MO;
+        if (optarg != NULL) {
+          char *fin;
+          cacheMo = strtol(optarg, &fin, 10);
+          if (fin == optarg || *fin != '\0' || cacheMo < 0) {
+            fprintf(stderr, "[decodeur] Budget de cache %s non valide (Mo)\n",
+                    optarg);
+            optionInvalide = 1;
+          }
+        }
+        break;
+      case OPTION_FORMAT:
+        format = parseFormat(optarg);
+        if (format < 0) {
+          printf("Format %s non valide, defaut sur celui du fichier\n", optarg);
+          format = FORMAT_AUTO;
+        }
+        break;
+      case 'j':
+        nbFils = atoi(optarg);
+        if (nbFils < 1 || nbFils > DECODEUR_FILS_MAX) {
+          printf("Nombre de fils %s non valide (1 a %d), defaut sur 1\n",
+                 optarg, DECODEUR_FILS_MAX);
+          nbFils = 1;
+        }
+        break;
+      default:
+        parseOptionCommune(c, optarg, &params);
+        break;
+      }
+    }
+    if (optionInvalide || argc - optind < 2 || argv[optind][0] == '\0' ||
+        argv[optind + 1][0] == '\0') {
+      fprintf(stderr,
+              "Usage: %s [options] [-j fils] [--start-frame N | --start-time s] "
+              "[--cache-decoded[=Mo]] [--format GRAY8|BGR24|I420|NV12] "
+              "<fichier.ulv> <identifiant_shm>\n",
+              argv[0]);
+      return -1;
+    }
+    files[0] = argv[optind];
+    files[1] = argv[optind + 1];
   }
 
   printf("[decodeur] Fichier ULV : %s\n", files[0]);
   printf("[decodeur] Zone mémoire partagée : %s\n", files[1]);
 
-  int fd = open(files[0], O_RDONLY);
-  if (fd < 0) {
-    perror("[decodeur] open ULV");
+  struct fichierULV fichier;
+  if (ouvrirULV(files[0], &fichier) != 0) {
+    fprintf(stderr, "[decodeur] Impossible d'ouvrir %s\n", files[0]);
     return -1;
   }
+  uint32_t largeur = fichier.largeur, hauteur = fichier.hauteur,
+           canaux = fichier.canaux, fps = fichier.fps;
 
-  struct stat stULV;
-  if (fstat(fd, &stULV) != 0) {
-    perror("[decodeur] fstat ULV");
-    close(fd);
-    return -1;
-  }
-  size_t fileSize = (size_t)stULV.st_size;
+  // L'index permet de commencer directement à n'importe quelle image
+  uint64_t premiere =
+      (tempsDepart >= 0.0)
+          ? trameULVAuTemps(&fichier, tempsDepart)
+          : (uint64_t)(trameDepart > 0 ? trameDepart : 0) % fichier.nbTrames;
 
-  const unsigned char *fileData = (const unsigned char *)mmap(
-      NULL, fileSize, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
-  if (fileData == MAP_FAILED) {
-    perror("[decodeur] mmap ULV");
-    close(fd);
-    return -1;
-  }
-  close(fd); // fd peut être fermé après mmap
-
-  if (fileSize < 20) {
-    fprintf(stderr, "[decodeur] Fichier ULV trop court\n");
-    return -1;
-  }
-  if (memcmp(fileData, "SETR", 4) != 0) {
-    fprintf(stderr, "[decodeur] Fichier ULV invalide (mauvais magic)\n");
-    return -1;
-  }
-
-  const unsigned char *p = fileData + 4;
-  uint32_t largeur, hauteur, canaux, fps;
-  memcpy(&largeur, p, sizeof(uint32_t));
-  memcpy(&hauteur, p + 4, sizeof(uint32_t));
-  memcpy(&canaux, p + 8, sizeof(uint32_t));
-  memcpy(&fps, p + 12, sizeof(uint32_t));
-
-  printf("[decodeur] Vidéo : %ux%u, %u canaux, %u fps\n", largeur, hauteur,
-         canaux, fps);
+  printf("[decodeur] Vidéo : %ux%u, %u canaux, %u fps, %u images (début : %llu)\n",
+         largeur, hauteur, canaux, fps, fichier.nbTrames,
+         (unsigned long long)premiere);
 
   struct videoInfos infos;
   infos.largeur = largeur;
   infos.hauteur = hauteur;
-  infos.canaux = canaux;
+  // Sans --format, le format est déduit du nombre de canaux du fichier
+  infos.canaux =
+      (format == FORMAT_AUTO) ? canaux : ((format == FORMAT_GRAY8) ? 1 : 3);
   infos.fps = fps;
+  infos.format = (uint32_t)format;
 
   struct memPartage zoneSortie;
   if (initMemoirePartageeEcrivain(files[1], &zoneSortie, &infos) != 0) {
@@ -132,66 +472,163 @@ int main(int argc, char *argv[]) {
     return -1;
   }
 
-  size_t tailleImage = (size_t)largeur * hauteur * canaux;
-  prepareMemoire(tailleImage, tailleImage);
+  // Chaque décodeur en cours utilise ses propres blocs, en plus des images
+  // en attente dans la file de réordonnancement. Un gros bloc doit contenir
+  // l'image entrelacée produite par jpgd, avant conversion en 4:2:0.
+  size_t tailleImage = tailleImageVideo(&infos);
+  size_t tailleDecodee = (size_t)largeur * hauteur * infos.canaux;
+  prepareMemoireN(tailleDecodee, tailleImage,
+                  (size_t)ALLOC_N_GROS_BLOCS * (size_t)nbFils);
   struct rlimit rl = {RLIM_INFINITY, RLIM_INFINITY};
   setrlimit(RLIMIT_MEMLOCK, &rl);
   mlockall(MCL_CURRENT | MCL_FUTURE);
 
-  appliquerOrdonnancement(&params, "decodeur");
-
-  const unsigned char *frameStart = fileData + 20; // début des trames
-  long cible_us = (fps > 0) ? (1000000L / (long)fps) : 33333L;
-
-  while (1) {
-    const unsigned char *cur = frameStart;
-
-    while (1) {
-      uint32_t frameSize;
-      memcpy(&frameSize, cur, sizeof(uint32_t));
-      cur += 4;
-
-      if (frameSize == 0)
-        break;
-
-      evenementProfilage(&profInfos, ETAT_TRAITEMENT);
-
-      struct timespec t_avant;
-      clock_gettime(CLOCK_MONOTONIC, &t_avant);
+  struct cacheImages cache;
+  if (initCache(&cache, (uint64_t)cacheMo, fichier.nbTrames,
+                tailleImage) != 0) {
+    fprintf(stderr, "[decodeur] Erreur d'allocation du cache\n");
+    return -1;
+  }
+  if (cache.nbCases > 0)
+    printf("[decodeur] Cache : %u images sur %u (%zu Mo)\n", cache.nbCases,
+           fichier.nbTrames, ((size_t)cache.nbCases * tailleImage) >> 20);
+
+  int64_t periode_ns = (fps > 0) ? (1000000000LL / (int64_t)fps) : 33333333LL;
+
+  if (nbFils > 1) {
+    printf("[decodeur] Décodage parallèle sur %d fils\n", nbFils);
+    static struct decodageParallele dp;
+    pthread_mutex_init(&dp.mutex, NULL);
+    pthread_cond_init(&dp.condTravail, NULL);
+    pthread_cond_init(&dp.condPret, NULL);
+    dp.fichier = &fichier;
+    dp.premiere = premiere;
+    dp.prochaineDistribuee = 0;
+    dp.prochainePubliee = 0;
+    dp.nbCases = 2 * nbFils;
+    dp.cases = (struct caseDecodee *)calloc((size_t)dp.nbCases,
+                                            sizeof(struct caseDecodee));
+    if (dp.cases == NULL) {
+      fprintf(stderr, "[decodeur] Erreur d'allocation de la file\n");
+      return -1;
+    }
+    for (int i = 0; i < dp.nbCases; i++)
+      dp.cases[i].numero = -1;
+    dp.infos = &infos;
+    dp.cache = &cache;
+    static struct SchedParams paramsFils;
+    partagerRuntime(&params, nbFils, "decodeur");
+    paramsFils = params;
+    dp.params = &paramsFils;
+
+    for (int i = 0; i < nbFils; i++) {
+      pthread_t fil;
+      if (pthread_create(&fil, NULL, filDecodage, &dp) != 0) {
+        fprintf(stderr, "[decodeur] Erreur pthread_create\n");
+        return -1;
+      }
+      pthread_detach(fil);
+    }
 
-      int w = 0, h = 0, comps = 0;
-      unsigned char *decoded = jpgd::decompress_jpeg_image_from_memory(
-          cur, (int)frameSize, &w, &h, &comps, (int)canaux);
-      cur += frameSize;
+    initCalibration(&profInfos, &params, fps, "decodeur");
+    calibrerAvecFils(&profInfos, &paramsFils, nbFils);
+    appliquerOrdonnancement(&params, "decodeur");
+
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    uint64_t nbPubliees = 0;
+    for (uint64_t n = 0;; n++) {
+      uint64_t suivante =
+          rattraperRetard(&t0, n, periode_ns, &zoneSortie, &profInfos);
+      if (suivante != n) {
+        sauterImages(&dp, (long)suivante);
+        n = suivante;
+      }
 
-      if (decoded == NULL) {
+      evenementProfilage(&profInfos, ETAT_ATTENTE_MUTEXLECTURE);
+      struct caseDecodee image;
+      prochaineImage(&dp, &image);
+      const unsigned char *source = image.cache ? image.cache : image.image;
+      if (source == NULL) {
         fprintf(stderr, "[decodeur] Erreur décompression JPEG\n");
         continue;
       }
 
-      struct timespec t_apres;
-      clock_gettime(CLOCK_MONOTONIC, &t_apres);
+      attendrePresentation(&t0, n, periode_ns, &profInfos);
 
       evenementProfilage(&profInfos, ETAT_ATTENTE_MUTEXECRITURE);
       attenteEcrivain(&zoneSortie);
+      if (nbPubliees == 1)
+        ancrerCadence(&t0, n, periode_ns);
 
       evenementProfilage(&profInfos, ETAT_TRAITEMENT);
-      memcpy(zoneSortie.data, decoded, tailleImage);
-
-      tempsreel_free(decoded);
+      memcpy(zoneSortie.data, source, tailleImage);
 
       signalEcrivain(&zoneSortie);
+      nbPubliees++;
+
+      if (image.image != NULL) {
+        ecrireCache(&cache, (uint32_t)((premiere + n) % fichier.nbTrames),
+                    image.image);
+        tempsreel_free(image.image);
+      }
 
       if (params.modeOrdonnanceur == ORDONNANCEMENT_DEADLINE) {
         sched_yield();
       }
+    }
+  }
 
-      long elapsed_us = (t_apres.tv_sec - t_avant.tv_sec) * 1000000L +
-                        (t_apres.tv_nsec - t_avant.tv_nsec) / 1000L;
-      if (elapsed_us < cible_us) {
-        evenementProfilage(&profInfos, ETAT_ENPAUSE);
-        usleep((useconds_t)(cible_us - elapsed_us));
+  initCalibration(&profInfos, &params, fps, "decodeur");
+  appliquerOrdonnancement(&params, "decodeur");
+
+  // Le fichier est relu en boucle : trameULV revient à l'image 0 après la
+  // dernière
+  struct timespec t0;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  uint64_t nbPubliees = 0;
+  for (uint64_t n = 0;; n++) {
+    n = rattraperRetard(&t0, n, periode_ns, &zoneSortie, &profInfos);
+
+    uint32_t indice = (uint32_t)((premiere + n) % fichier.nbTrames);
+    const unsigned char *source = lireCache(&cache, indice);
+    unsigned char *decoded = NULL;
+
+    if (source == NULL) {
+      uint32_t frameSize;
+      const unsigned char *cur = trameULV(&fichier, indice, &frameSize);
+
+      evenementProfilage(&profInfos, ETAT_TRAITEMENT);
+
+      decoded = decoderImage(cur, frameSize, &infos);
+
+      if (decoded == NULL) {
+        fprintf(stderr, "[decodeur] Erreur décompression JPEG\n");
+        continue;
       }
+      source = decoded;
+    }
+
+    attendrePresentation(&t0, n, periode_ns, &profInfos);
+
+    evenementProfilage(&profInfos, ETAT_ATTENTE_MUTEXECRITURE);
+    attenteEcrivain(&zoneSortie);
+    if (nbPubliees == 1)
+      ancrerCadence(&t0, n, periode_ns);
+
+    evenementProfilage(&profInfos, ETAT_TRAITEMENT);
+    memcpy(zoneSortie.data, source, tailleImage);
+
+    signalEcrivain(&zoneSortie);
+    nbPubliees++;
+
+    if (decoded != NULL) {
+      ecrireCache(&cache, indice, decoded);
+      tempsreel_free(decoded);
+    }
+
+    if (params.modeOrdonnanceur == ORDONNANCEMENT_DEADLINE) {
+      sched_yield();
     }
   }
 
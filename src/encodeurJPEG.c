@@ -0,0 +1,373 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier implémentant l'encodeur JPEG baseline (utilisé par genererULV)
+ ******************************************************************************/
+
+#include "encodeurJPEG.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Position naturelle (ligne * 8 + colonne) du coefficient k dans l'ordre zigzag
+static const uint8_t zigzag[64] = {
+    0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6,  7,  14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+// Tables de quantification de l'annexe K (ordre naturel), qualité 50
+static const uint8_t quantLuminance[64] = {
+    16, 11, 10, 16, 24,  40,  51,  61,  12, 12, 14, 19, 26,  58,  60,  55,
+    14, 13, 16, 24, 40,  57,  69,  56,  14, 17, 22, 29, 51,  87,  80,  62,
+    18, 22, 37, 56, 68,  109, 103, 77,  24, 35, 55, 64, 81,  104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99};
+
+static const uint8_t quantChrominance[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99};
+
+// Tables de Huffman de l'annexe K : nombre de codes de chaque longueur (1 à 16
+// bits), puis les symboles dans l'ordre des codes
+static const uint8_t dcLuminanceBits[16] = {0, 1, 5, 1, 1, 1, 1, 1,
+                                            1, 0, 0, 0, 0, 0, 0, 0};
+static const uint8_t dcChrominanceBits[16] = {0, 3, 1, 1, 1, 1, 1, 1,
+                                              1, 1, 1, 0, 0, 0, 0, 0};
+static const uint8_t dcValeurs[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+static const uint8_t acLuminanceBits[16] = {0, 2, 1, 3, 3, 2, 4, 3,
+                                            5, 5, 4, 4, 0, 0, 1, 0x7d};
+static const uint8_t acLuminanceValeurs[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06,
+    0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08,
+    0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72,
+    0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45,
+    0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+    0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75,
+    0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3,
+    0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6,
+    0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9,
+    0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4,
+    0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa};
+
+static const uint8_t acChrominanceBits[16] = {0, 2, 1, 2, 4, 4, 3, 4,
+                                              7, 5, 4, 4, 0, 1, 2, 0x77};
+static const uint8_t acChrominanceValeurs[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41,
+    0x51, 0x07, 0x61, 0x71, 0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91,
+    0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1,
+    0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44,
+    0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+    0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74,
+    0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a,
+    0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4,
+    0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+    0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4,
+    0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa};
+
+struct codesHuffman {
+  uint16_t code[256];
+  uint8_t longueur[256];
+};
+
+// Table 0 : luminance, table 1 : chrominance
+struct encodeur {
+  struct tamponJPEG *tampon;
+  int erreur;
+  float diviseurs[2][64]; // Pas de quantification (ordre naturel)
+  uint8_t quant[2][64];   // Tables écrites dans le fichier (ordre zigzag)
+  struct codesHuffman dc[2];
+  struct codesHuffman ac[2];
+  float cosinus[8][8];    // C(u)/2 * cos((2x+1)u pi / 16)
+};
+
+// Codes canoniques (annexe C) à partir du nombre de codes de chaque longueur
+static void construireCodes(const uint8_t bits[16], const uint8_t *valeurs,
+                            struct codesHuffman *codes) {
+  uint16_t code = 0;
+  int k = 0;
+  memset(codes, 0, sizeof(*codes));
+  for (int longueur = 1; longueur <= 16; longueur++) {
+    for (int i = 0; i < bits[longueur - 1]; i++, k++) {
+      codes->code[valeurs[k]] = code++;
+      codes->longueur[valeurs[k]] = (uint8_t)longueur;
+    }
+    code <<= 1;
+  }
+}
+
+// Mise à l'échelle de libjpeg : qualité 50 = tables de l'annexe K
+static void construireQuantification(const uint8_t base[64], int qualite,
+                                     uint8_t zz[64], float diviseurs[64]) {
+  int echelle = (qualite < 50) ? 5000 / qualite : 200 - 2 * qualite;
+  for (int k = 0; k < 64; k++) {
+    int n = zigzag[k];
+    int q = (base[n] * echelle + 50) / 100;
+    if (q < 1)
+      q = 1;
+    if (q > 255)
+      q = 255;
+    zz[k] = (uint8_t)q;
+    diviseurs[n] = (float)q;
+  }
+}
+
+static void ajouterOctet(struct encodeur *e, unsigned char octet) {
+  struct tamponJPEG *t = e->tampon;
+  if (t->taille == t->capacite) {
+    size_t capacite = (t->capacite > 0) ? t->capacite * 2 : 65536;
+    unsigned char *donnees = (unsigned char *)realloc(t->donnees, capacite);
+    if (donnees == NULL) {
+      e->erreur = 1;
+      return;
+    }
+    t->donnees = donnees;
+    t->capacite = capacite;
+  }
+  t->donnees[t->taille++] = octet;
+}
+
+static void ajouterMot(struct encodeur *e, uint16_t mot) {
+  ajouterOctet(e, (unsigned char)(mot >> 8));
+  ajouterOctet(e, (unsigned char)(mot & 0xFF));
+}
+
+// Écrit les longueur bits de poids faible de code dans les données compressées,
+// en insérant un 0x00 après chaque 0xFF (un 0xFF seul serait lu comme un marqueur)
+static void ecrireBits(struct encodeur *e, uint32_t code, int longueur) {
+  struct tamponJPEG *t = e->tampon;
+  t->accumulateur = (t->accumulateur << longueur) | (code & ((1u << longueur) - 1));
+  t->nbBits += longueur;
+  while (t->nbBits >= 8) {
+    unsigned char octet = (unsigned char)(t->accumulateur >> (t->nbBits - 8));
+    ajouterOctet(e, octet);
+    if (octet == 0xFF)
+      ajouterOctet(e, 0);
+    t->nbBits -= 8;
+  }
+}
+
+// Écrit une valeur sous la forme (catégorie, bits) : le symbole symbole | catégorie
+// par le code de Huffman, puis les bits de la valeur (complément à un si négative)
+static void ecrireValeur(struct encodeur *e, const struct codesHuffman *codes,
+                         int symbole, int valeur) {
+  int categorie = 0;
+  for (int a = abs(valeur); a != 0; a >>= 1)
+    categorie++;
+  symbole |= categorie;
+  ecrireBits(e, codes->code[symbole], codes->longueur[symbole]);
+  if (categorie > 0)
+    ecrireBits(e, (uint32_t)((valeur < 0) ? valeur - 1 : valeur), categorie);
+}
+
+static int bornerCoefficient(float valeur) {
+  long q = lrintf(valeur);
+  if (q > 1023)
+    return 1023;
+  if (q < -1023)
+    return -1023;
+  return (int)q;
+}
+
+// DCT, quantification et codage entropique d'un bloc 8x8 (valeurs centrées sur 0)
+static void encoderBloc(struct encodeur *e, const float bloc[64], int table,
+                        int *dcPrecedent) {
+  float lignes[64], coef[64];
+  for (int y = 0; y < 8; y++) {
+    for (int u = 0; u < 8; u++) {
+      float s = 0.0f;
+      for (int x = 0; x < 8; x++)
+        s += e->cosinus[u][x] * bloc[y * 8 + x];
+      lignes[y * 8 + u] = s;
+    }
+  }
+  for (int v = 0; v < 8; v++) {
+    for (int u = 0; u < 8; u++) {
+      float s = 0.0f;
+      for (int y = 0; y < 8; y++)
+        s += e->cosinus[v][y] * lignes[y * 8 + u];
+      coef[v * 8 + u] = s;
+    }
+  }
+
+  int dc = bornerCoefficient(coef[0] / e->diviseurs[table][0]);
+  ecrireValeur(e, &e->dc[table], 0, dc - *dcPrecedent);
+  *dcPrecedent = dc;
+
+  int zeros = 0;
+  for (int k = 1; k < 64; k++) {
+    int n = zigzag[k];
+    int ac = bornerCoefficient(coef[n] / e->diviseurs[table][n]);
+    if (ac == 0) {
+      zeros++;
+      continue;
+    }
+    for (; zeros > 15; zeros -= 16) // ZRL : 16 zéros
+      ecrireBits(e, e->ac[table].code[0xF0], e->ac[table].longueur[0xF0]);
+    ecrireValeur(e, &e->ac[table], zeros << 4, ac);
+    zeros = 0;
+  }
+  if (zeros > 0) // EOB : le reste du bloc est nul
+    ecrireBits(e, e->ac[table].code[0x00], e->ac[table].longueur[0x00]);
+}
+
+static void ecrireTableHuffman(struct encodeur *e, int classeId,
+                               const uint8_t bits[16], const uint8_t *valeurs) {
+  int nb = 0;
+  ajouterOctet(e, (unsigned char)classeId);
+  for (int i = 0; i < 16; i++) {
+    ajouterOctet(e, bits[i]);
+    nb += bits[i];
+  }
+  for (int i = 0; i < nb; i++)
+    ajouterOctet(e, valeurs[i]);
+}
+
+static void ecrireEntetes(struct encodeur *e, uint32_t largeur,
+                          uint32_t hauteur, uint32_t canaux) {
+  static const unsigned char jfif[] = {0xFF, 0xE0, 0x00, 0x10, 'J',  'F',
+                                       'I',  'F',  0x00, 0x01, 0x01, 0x00,
+                                       0x00, 0x01, 0x00, 0x01, 0x00, 0x00};
+  int nbTables = (canaux == 3) ? 2 : 1;
+
+  ajouterMot(e, 0xFFD8); // SOI
+  for (size_t i = 0; i < sizeof(jfif); i++)
+    ajouterOctet(e, jfif[i]);
+
+  ajouterMot(e, 0xFFDB); // DQT
+  ajouterMot(e, (uint16_t)(2 + 65 * nbTables));
+  for (int t = 0; t < nbTables; t++) {
+    ajouterOctet(e, (unsigned char)t);
+    for (int k = 0; k < 64; k++)
+      ajouterOctet(e, e->quant[t][k]);
+  }
+
+  ajouterMot(e, 0xFFC0); // SOF0 (baseline)
+  ajouterMot(e, (uint16_t)(8 + 3 * canaux));
+  ajouterOctet(e, 8);
+  ajouterMot(e, (uint16_t)hauteur);
+  ajouterMot(e, (uint16_t)largeur);
+  ajouterOctet(e, (unsigned char)canaux);
+  for (uint32_t c = 0; c < canaux; c++) {
+    ajouterOctet(e, (unsigned char)(c + 1));
+    // Y sous-échantillonne Cb et Cr d'un facteur 2 dans les deux directions
+    ajouterOctet(e, (c == 0 && canaux == 3) ? 0x22 : 0x11);
+    ajouterOctet(e, (c == 0) ? 0 : 1);
+  }
+
+  ajouterMot(e, 0xFFC4); // DHT
+  ajouterMot(e, (uint16_t)(2 + (17 + 12) + (17 + 162) +
+                           ((nbTables == 2) ? (17 + 12) + (17 + 162) : 0)));
+  ecrireTableHuffman(e, 0x00, dcLuminanceBits, dcValeurs);
+  ecrireTableHuffman(e, 0x10, acLuminanceBits, acLuminanceValeurs);
+  if (nbTables == 2) {
+    ecrireTableHuffman(e, 0x01, dcChrominanceBits, dcValeurs);
+    ecrireTableHuffman(e, 0x11, acChrominanceBits, acChrominanceValeurs);
+  }
+
+  ajouterMot(e, 0xFFDA); // SOS
+  ajouterMot(e, (uint16_t)(6 + 2 * canaux));
+  ajouterOctet(e, (unsigned char)canaux);
+  for (uint32_t c = 0; c < canaux; c++) {
+    ajouterOctet(e, (unsigned char)(c + 1));
+    ajouterOctet(e, (c == 0) ? 0x00 : 0x11);
+  }
+  ajouterOctet(e, 0);  // Ss
+  ajouterOctet(e, 63); // Se
+  ajouterOctet(e, 0);  // Ah, Al
+}
+
+int encoderJPEG(const unsigned char *pixels, uint32_t largeur, uint32_t hauteur,
+                uint32_t canaux, int qualite, struct tamponJPEG *tampon) {
+  struct encodeur e;
+  if (qualite < 1)
+    qualite = 1;
+  if (qualite > 100)
+    qualite = 100;
+
+  e.tampon = tampon;
+  e.erreur = 0;
+  tampon->taille = 0;
+  tampon->accumulateur = 0;
+  tampon->nbBits = 0;
+  construireQuantification(quantLuminance, qualite, e.quant[0], e.diviseurs[0]);
+  construireQuantification(quantChrominance, qualite, e.quant[1], e.diviseurs[1]);
+  construireCodes(dcLuminanceBits, dcValeurs, &e.dc[0]);
+  construireCodes(acLuminanceBits, acLuminanceValeurs, &e.ac[0]);
+  construireCodes(dcChrominanceBits, dcValeurs, &e.dc[1]);
+  construireCodes(acChrominanceBits, acChrominanceValeurs, &e.ac[1]);
+  for (int u = 0; u < 8; u++)
+    for (int x = 0; x < 8; x++)
+      e.cosinus[u][x] = (float)(((u == 0) ? M_SQRT1_2 : 1.0) / 2.0 *
+                                cos((2 * x + 1) * u * M_PI / 16.0));
+
+  ecrireEntetes(&e, largeur, hauteur, canaux);
+
+  // Les pixels hors de l'image (dernière ligne et dernière colonne de blocs)
+  // répètent le bord
+  int dcPrecedent[3] = {0, 0, 0};
+  float bloc[64];
+  if (canaux == 1) {
+    for (uint32_t by = 0; by < hauteur; by += 8) {
+      for (uint32_t bx = 0; bx < largeur; bx += 8) {
+        for (uint32_t y = 0; y < 8; y++) {
+          uint32_t py = (by + y < hauteur) ? by + y : hauteur - 1;
+          for (uint32_t x = 0; x < 8; x++) {
+            uint32_t px = (bx + x < largeur) ? bx + x : largeur - 1;
+            bloc[y * 8 + x] = (float)pixels[py * largeur + px] - 128.0f;
+          }
+        }
+        encoderBloc(&e, bloc, 0, &dcPrecedent[0]);
+      }
+    }
+  } else {
+    float cb[64], cr[64];
+    for (uint32_t my = 0; my < hauteur; my += 16) {
+      for (uint32_t mx = 0; mx < largeur; mx += 16) {
+        memset(cb, 0, sizeof(cb));
+        memset(cr, 0, sizeof(cr));
+        for (uint32_t sous = 0; sous < 4; sous++) {
+          uint32_t by = my + (sous / 2) * 8, bx = mx + (sous % 2) * 8;
+          for (uint32_t y = 0; y < 8; y++) {
+            uint32_t py = (by + y < hauteur) ? by + y : hauteur - 1;
+            for (uint32_t x = 0; x < 8; x++) {
+              uint32_t px = (bx + x < largeur) ? bx + x : largeur - 1;
+              const unsigned char *p = pixels + ((size_t)py * largeur + px) * 3;
+              float r = p[0], g = p[1], b = p[2];
+              bloc[y * 8 + x] = 0.299f * r + 0.587f * g + 0.114f * b - 128.0f;
+              // Moyenne 2x2 pour la chrominance
+              int c = ((sous / 2) * 8 + y) / 2 * 8 + ((sous % 2) * 8 + x) / 2;
+              cb[c] += 0.25f * (-0.168736f * r - 0.331264f * g + 0.5f * b);
+              cr[c] += 0.25f * (0.5f * r - 0.418688f * g - 0.081312f * b);
+            }
+          }
+          encoderBloc(&e, bloc, 0, &dcPrecedent[0]);
+        }
+        encoderBloc(&e, cb, 1, &dcPrecedent[1]);
+        encoderBloc(&e, cr, 1, &dcPrecedent[2]);
+      }
+    }
+  }
+
+  if (tampon->nbBits > 0) // Complète le dernier octet avec des 1
+    ecrireBits(&e, 0x7F, 8 - tampon->nbBits);
+  ajouterMot(&e, 0xFFD9); // EOI
+  return e.erreur ? -1 : 0;
+}
+
+void libererTamponJPEG(struct tamponJPEG *tampon) {
+  free(tampon->donnees);
+  memset(tampon, 0, sizeof(*tampon));
+}
@@ -0,0 +1,55 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier de déclaration de l'encodeur JPEG (utilisé par genererULV)
+ ******************************************************************************/
+
+#ifndef ENCODEUR_JPEG_H
+#define ENCODEUR_JPEG_H
+
+// Permet de protéger le header lorsqu'il est inclus par un fichier C++
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+ * Encodeur JPEG baseline minimal : DCT flottante, tables de quantification
+ * et de Huffman standard (annexe K de la norme), qualité à la manière de
+ * libjpeg (1 à 100). Les images couleur sont encodées en YCbCr 4:2:0, comme
+ * celles produites par videoConverter.py; les images à un canal, en niveaux
+ * de gris. Le résultat est lisible par jpgd (et par tout décodeur JPEG).
+ * L'encodeur n'est pas optimisé : il sert à produire des fichiers de test,
+ * pas à tourner dans le pipeline.
+ ******************************************************************************/
+
+    struct tamponJPEG
+    {
+        unsigned char *donnees;   // JPEG encodé (agrandi au besoin)
+        size_t taille;            // Octets utilisés
+        size_t capacite;          // Octets alloués
+        uint32_t accumulateur;    // Bits en attente d'être écrits
+        int nbBits;
+    };
+
+    // Encode une image RGB24 (canaux = 3) ou en niveaux de gris (canaux = 1) de
+    // largeur x hauteur pixels. Le tampon est vidé puis rempli (tampon->taille octets);
+    // il peut être réutilisé d'une image à l'autre. Retourne 0 en cas de succès, -1 si
+    // l'allocation échoue.
+    int encoderJPEG(const unsigned char *pixels, uint32_t largeur, uint32_t hauteur,
+                    uint32_t canaux, int qualite, struct tamponJPEG *tampon);
+
+    // Libère le tampon
+    void libererTamponJPEG(struct tamponJPEG *tampon);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
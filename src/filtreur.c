@@ -16,12 +16,8 @@
 int main(int argc, char *argv[]) {
   setbuf(stdout, NULL);
 
-  char signatureProfilage[128] = {0};
-  char *nomProgramme = (argv[0][0] == '.') ? argv[0] + 2 : argv[0];
-  snprintf(signatureProfilage, 128, "profilage-%s-%u.txt", nomProgramme,
-           (unsigned int)getpid());
   InfosProfilage profInfos;
-  initProfilage(&profInfos, signatureProfilage);
+  initProfilage(&profInfos, argv[0]);
   evenementProfilage(&profInfos, ETAT_INITIALISATION);
 
   struct SchedParams params = {
@@ -42,18 +38,13 @@ int main(int argc, char *argv[]) {
   } else {
     int c;
     opterr = 0;
-    while ((c = getopt(argc, argv, "s:d:f:")) != -1) {
+    while ((c = getopt(argc, argv, OPTIONS_COMMUNES "f:")) != -1) {
       switch (c) {
-      case 's':
-        parseSchedOption(optarg, &params);
-        break;
-      case 'd':
-        parseDeadlineParams(optarg, &params);
-        break;
       case 'f':
         typeFiltre = atoi(optarg);
         break;
       default:
+        parseOptionCommune(c, optarg, &params);
         break;
       }
     }
@@ -79,12 +70,14 @@ int main(int argc, char *argv[]) {
   uint32_t haut = zoneEntree.header->infos.hauteur;
   uint32_t canaux = zoneEntree.header->infos.canaux;
   uint32_t fps = zoneEntree.header->infos.fps;
+  uint32_t format = formatVideo(&zoneEntree.header->infos);
 
   struct videoInfos infosOut;
   infosOut.largeur = larg;
   infosOut.hauteur = haut;
   infosOut.canaux = canaux;
   infosOut.fps = fps;
+  infosOut.format = format;
   struct memPartage zoneSortie;
   if (initMemoirePartageeEcrivain(sortie, &zoneSortie, &infosOut) != 0) {
     fprintf(stderr, "[filtreur] Échec initMemoirePartageeEcrivain(%s)\n",
@@ -92,12 +85,17 @@ int main(int argc, char *argv[]) {
     return -1;
   }
 
-  size_t tailleImage = (size_t)larg * haut * canaux;
+  // Les formats planaires sont filtrés plan par plan (la chrominance 4:2:0 a
+  // quatre fois moins de pixels que la luminance)
+  size_t tailleImage = tailleImageVideo(&infosOut);
+  struct planImage plans[PLANS_MAX];
+  int nbPlans = plansImage(format, larg, haut, plans);
 
   prepareMemoire(tailleImage * 4, tailleImage);
   struct rlimit rl = {RLIM_INFINITY, RLIM_INFINITY};
   setrlimit(RLIMIT_MEMLOCK, &rl);
   mlockall(MCL_CURRENT | MCL_FUTURE);
+  initCalibration(&profInfos, &params, fps, "filtreur");
   appliquerOrdonnancement(&params, "filtreur");
 
   unsigned char *bufEntree =
@@ -119,11 +117,22 @@ int main(int argc, char *argv[]) {
     evenementProfilage(&profInfos, ETAT_TRAITEMENT);
     memcpy(bufEntree, zoneEntree.data, tailleImage);
     signalLecteur(&zoneEntree);
-
-    if (typeFiltre == 0)
-      lowpassFilter(haut, larg, bufEntree, bufSortie, 3, 5.0f, canaux);
-    else
-      highpassFilter(haut, larg, bufEntree, bufSortie, 3, 5.0f, canaux);
+    propagerSautees(&zoneEntree, &zoneSortie);
+
+    for (int p = 0; p < nbPlans; p++) {
+      const struct planImage *pl = &plans[p];
+      if (typeFiltre == 0)
+        lowpassFilter(pl->hauteur, pl->largeur, bufEntree + pl->decalage,
+                      bufSortie + pl->decalage, 3, 5.0f, pl->canaux);
+      else if (p == 0)
+        highpassFilter(pl->hauteur, pl->largeur, bufEntree + pl->decalage,
+                       bufSortie + pl->decalage, 3, 5.0f, pl->canaux);
+      else
+        // Le passe-haut d'un plan de chrominance uni donne 0, soit du vert
+        // saturé : les contours sont rendus en gris (chrominance neutre)
+        memset(bufSortie + pl->decalage, 128,
+               (size_t)pl->largeur * pl->hauteur * pl->canaux);
+    }
 
     evenementProfilage(&profInfos, ETAT_ATTENTE_MUTEXECRITURE);
     attenteEcrivain(&zoneSortie);
@@ -0,0 +1,221 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier implémentant le générateur de fichiers ULV synthétiques
+ ******************************************************************************/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "encodeurJPEG.h"
+
+/******************************************************************************
+ * Produit un fichier ULV (format : voir decodeur.c) sans vidéo source, pour
+ * mesurer le pipeline sur n'importe quelle machine (voir bancEssai.py). Les
+ * images sont calculées puis encodées en JPEG (encodeurJPEG.h); elles sont
+ * déterministes : deux fichiers générés avec les mêmes options sont
+ * identiques.
+ * La complexité (-c) règle le coût du contenu pour le décodeur et la taille
+ * des JPEG :
+ *   0 : couleur unie qui change à chaque image (JPEG minimal)
+ *   1 : dégradés qui défilent (peu de hautes fréquences)
+ *   2 : dégradés, damier et disques en mouvement (arêtes franches, proche
+ *       d'un film d'animation)
+ *   3 : comme 2, plus un bruit aléatoire sur chaque pixel (grain de film,
+ *       pire cas pour le décodage entropique)
+ ******************************************************************************/
+#define COMPLEXITE_MAX 3
+
+struct optionsGeneration {
+  uint32_t largeur, hauteur, canaux, fps, nbImages;
+  int complexite, qualite;
+};
+
+static unsigned char saturer(int v) {
+  return (unsigned char)((v < 0) ? 0 : ((v > 255) ? 255 : v));
+}
+
+// Générateur pseudo-aléatoire (xorshift32), pour que le bruit soit reproductible
+static uint32_t aleatoire(uint32_t *etat) {
+  uint32_t x = *etat;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *etat = x;
+  return x;
+}
+
+// Calcule l'image k en RGB24 (ou en niveaux de gris si canaux = 1)
+static void genererImage(const struct optionsGeneration *o, uint32_t k,
+                         unsigned char *pixels) {
+  const uint32_t w = o->largeur, h = o->hauteur;
+  const double t = (double)k / o->fps;
+  uint32_t graine = 2463534242u ^ (k * 2654435761u);
+
+  // Trois disques qui rebondissent et un damier qui défile (complexité >= 2)
+  int cx[3], cy[3], rayon = (int)(h / 6) + 1;
+  for (int d = 0; d < 3; d++) {
+    cx[d] = (int)((0.5 + 0.4 * sin(t * (0.7 + 0.3 * d) + d)) * w);
+    cy[d] = (int)((0.5 + 0.4 * cos(t * (0.5 + 0.2 * d) + 2 * d)) * h);
+  }
+  int pasDamier = (int)(h / 12) + 1;
+  int decalage = (int)(t * 40.0);
+
+  for (uint32_t y = 0; y < h; y++) {
+    for (uint32_t x = 0; x < w; x++) {
+      int r, g, b;
+      if (o->complexite == 0) {
+        r = (int)(k * 3) & 0xFF;
+        g = (int)(k * 5 + 85) & 0xFF;
+        b = (int)(k * 7 + 170) & 0xFF;
+      } else {
+        r = (int)(((x + (uint32_t)decalage) * 255) / w) & 0xFF;
+        g = (int)((y * 255) / h);
+        b = (int)(128 + 127 * sin(t + x * 0.02));
+      }
+      if (o->complexite >= 2) {
+        int cx0 = ((int)x + decalage) / pasDamier, cy0 = (int)y / pasDamier;
+        if (y > h * 2 / 3 && ((cx0 + cy0) & 1)) {
+          r = 255 - r;
+          g = 255 - g;
+        }
+        for (int d = 0; d < 3; d++) {
+          int dx = (int)x - cx[d], dy = (int)y - cy[d];
+          if (dx * dx + dy * dy < rayon * rayon) {
+            r = (d == 0) ? 230 : 40;
+            g = (d == 1) ? 220 : 30;
+            b = (d == 2) ? 240 : 50;
+          }
+        }
+      }
+      if (o->complexite >= 3) {
+        int bruit = (int)(aleatoire(&graine) % 97) - 48;
+        r += bruit;
+        g += bruit;
+        b += bruit;
+      }
+      if (o->canaux == 1) {
+        pixels[y * w + x] = saturer((r * 77 + g * 150 + b * 29) >> 8);
+      } else {
+        unsigned char *p = pixels + ((size_t)y * w + x) * 3;
+        p[0] = saturer(r);
+        p[1] = saturer(g);
+        p[2] = saturer(b);
+      }
+    }
+  }
+}
+
+static int ecrireU32(FILE *f, uint32_t v) {
+  return (fwrite(&v, sizeof(v), 1, f) == 1) ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+  struct optionsGeneration o = {
+      .largeur = 427,
+      .hauteur = 240,
+      .canaux = 3,
+      .fps = 30,
+      .nbImages = 300,
+      .complexite = 2,
+      .qualite = 65, // Comme videoConverter.py
+  };
+
+  int c;
+  while ((c = getopt(argc, argv, "w:h:f:n:c:q:g")) != -1) {
+    switch (c) {
+    case 'w':
+      o.largeur = (uint32_t)atoi(optarg);
+      break;
+    case 'h':
+      o.hauteur = (uint32_t)atoi(optarg);
+      break;
+    case 'f':
+      o.fps = (uint32_t)atoi(optarg);
+      break;
+    case 'n':
+      o.nbImages = (uint32_t)atoi(optarg);
+      break;
+    case 'c':
+      o.complexite = atoi(optarg);
+      break;
+    case 'q':
+      o.qualite = atoi(optarg);
+      break;
+    case 'g':
+      o.canaux = 1;
+      break;
+    default:
+      break;
+    }
+  }
+  if (argc - optind < 1 || o.largeur == 0 || o.hauteur == 0 ||
+      o.largeur > 65535 || o.hauteur > 65535 || o.fps == 0 ||
+      o.nbImages == 0 || o.complexite < 0 || o.complexite > COMPLEXITE_MAX) {
+    fprintf(stderr,
+            "Usage: %s [-w largeur] [-h hauteur] [-f fps] [-n images] "
+            "[-c complexite 0-%d] [-q qualite 1-100] [-g] sortie.ulv\n",
+            argv[0], COMPLEXITE_MAX);
+    return -1;
+  }
+  const char *nomSortie = argv[optind];
+
+  unsigned char *pixels =
+      (unsigned char *)malloc((size_t)o.largeur * o.hauteur * o.canaux);
+  if (pixels == NULL) {
+    fprintf(stderr, "[genererULV] Erreur d'allocation de l'image\n");
+    return -1;
+  }
+  FILE *f = fopen(nomSortie, "wb");
+  if (f == NULL) {
+    perror("[genererULV] fopen");
+    free(pixels);
+    return -1;
+  }
+
+  struct timespec debut, fin;
+  clock_gettime(CLOCK_MONOTONIC, &debut);
+
+  int erreur = (fwrite("SETR", 4, 1, f) != 1) || ecrireU32(f, o.largeur) ||
+               ecrireU32(f, o.hauteur) || ecrireU32(f, o.canaux) ||
+               ecrireU32(f, o.fps);
+  struct tamponJPEG jpeg = {0};
+  uint64_t total = 0;
+  for (uint32_t k = 0; k < o.nbImages && !erreur; k++) {
+    genererImage(&o, k, pixels);
+    if (encoderJPEG(pixels, o.largeur, o.hauteur, o.canaux, o.qualite,
+                    &jpeg) != 0) {
+      fprintf(stderr, "[genererULV] Erreur d'encodage de l'image %u\n", k);
+      erreur = 1;
+      break;
+    }
+    erreur = ecrireU32(f, (uint32_t)jpeg.taille) ||
+             (fwrite(jpeg.donnees, jpeg.taille, 1, f) != 1);
+    total += jpeg.taille;
+  }
+  erreur = erreur || ecrireU32(f, 0); // Fin du fichier
+  if (fclose(f) != 0)
+    erreur = 1;
+  libererTamponJPEG(&jpeg);
+  free(pixels);
+  if (erreur) {
+    fprintf(stderr, "[genererULV] Erreur d'ecriture de %s\n", nomSortie);
+    return -1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &fin);
+  printf("[genererULV] %s : %u images %ux%u, %u canaux, %u fps, complexite %d, "
+         "%.1f Ko par image, genere en %.1f s\n",
+         nomSortie, o.nbImages, o.largeur, o.hauteur, o.canaux, o.fps,
+         o.complexite, total / 1024.0 / o.nbImages,
+         (fin.tv_sec - debut.tv_sec) + (fin.tv_nsec - debut.tv_nsec) * 1e-9);
+  return 0;
+}
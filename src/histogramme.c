@@ -0,0 +1,84 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier implémentant l'histogramme de latences
+ ******************************************************************************/
+
+#include "histogramme.h"
+
+#include <math.h>
+#include <string.h>
+
+static uint32_t indiceCase(uint64_t valeur) {
+  if (valeur < HISTO_SOUS)
+    return (uint32_t)valeur;
+  uint32_t e = 63u - (uint32_t)__builtin_clzll(valeur);
+  if (e >= HISTO_BITS_MAX)
+    return HISTO_NB_CASES - 1;
+  uint32_t sous = (uint32_t)(valeur >> (e - HISTO_BITS_SOUS)) & (HISTO_SOUS - 1);
+  return (e - HISTO_BITS_SOUS + 1) * HISTO_SOUS + sous;
+}
+
+// Plus grande valeur qui tombe dans la case indice
+static uint64_t borneCase(uint32_t indice) {
+  if (indice < HISTO_SOUS)
+    return indice;
+  uint32_t e = indice / HISTO_SOUS + HISTO_BITS_SOUS - 1;
+  uint64_t sous = indice % HISTO_SOUS;
+  uint64_t largeur = 1ULL << (e - HISTO_BITS_SOUS);
+  return (HISTO_SOUS + sous) * largeur + largeur - 1;
+}
+
+void histoReinitialiser(struct histogramme *h) { memset(h, 0, sizeof(*h)); }
+
+void histoAjouter(struct histogramme *h, uint64_t valeur) {
+  h->cases[indiceCase(valeur)]++;
+  h->nb++;
+  if (valeur > h->max)
+    h->max = valeur;
+  double v = (double)valeur;
+  h->somme += v;
+  h->sommeCarres += v * v;
+}
+
+void histoFusionner(struct histogramme *h, const struct histogramme *source) {
+  for (uint32_t i = 0; i < HISTO_NB_CASES; i++)
+    h->cases[i] += source->cases[i];
+  h->nb += source->nb;
+  if (source->max > h->max)
+    h->max = source->max;
+  h->somme += source->somme;
+  h->sommeCarres += source->sommeCarres;
+}
+
+uint64_t histoPercentile(const struct histogramme *h, double p) {
+  if (h->nb == 0)
+    return 0;
+  uint64_t rang = (uint64_t)ceil(p / 100.0 * (double)h->nb);
+  if (rang < 1)
+    rang = 1;
+  uint64_t cumul = 0;
+  for (uint32_t i = 0; i < HISTO_NB_CASES; i++) {
+    cumul += h->cases[i];
+    if (cumul >= rang) {
+      uint64_t borne = borneCase(i);
+      return (borne < h->max) ? borne : h->max;
+    }
+  }
+  return h->max;
+}
+
+double histoMoyenne(const struct histogramme *h) {
+  return (h->nb > 0) ? h->somme / (double)h->nb : 0.0;
+}
+
+double histoEcartType(const struct histogramme *h) {
+  if (h->nb == 0)
+    return 0.0;
+  double moyenne = histoMoyenne(h);
+  double variance = h->sommeCarres / (double)h->nb - moyenne * moyenne;
+  return (variance > 0.0) ? sqrt(variance) : 0.0;
+}
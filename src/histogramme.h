@@ -0,0 +1,70 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier de déclaration de l'histogramme de latences (percentiles sans
+ * conserver les mesures)
+ ******************************************************************************/
+
+#ifndef HISTOGRAMME_H
+#define HISTOGRAMME_H
+
+// Permet de protéger le header lorsqu'il est inclus par un fichier C++
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+/******************************************************************************
+ * Histogramme à cases fixes, log-linéaire (à la manière de HdrHistogram) :
+ * les valeurs 0 à 2^HISTO_BITS_SOUS-1 ont chacune leur case, puis chaque
+ * puissance de deux est découpée en 2^HISTO_BITS_SOUS cases égales. L'erreur
+ * relative d'une valeur retrouvée est donc d'au plus 1 / 2^HISTO_BITS_SOUS
+ * (6,25 %), de 1 à 2^32 unités. Les valeurs plus grandes tombent dans la
+ * dernière case.
+ * L'unité est au choix de l'appelant (le compositeur compte en microsecondes).
+ * histoAjouter ne fait qu'un calcul d'indice et quelques additions : aucune
+ * allocation, utilisable dans une boucle temps réel.
+ ******************************************************************************/
+
+#define HISTO_BITS_SOUS 4
+#define HISTO_SOUS (1u << HISTO_BITS_SOUS)
+#define HISTO_BITS_MAX 32
+#define HISTO_NB_CASES ((HISTO_BITS_MAX - HISTO_BITS_SOUS + 1) * HISTO_SOUS)
+
+    struct histogramme
+    {
+        uint32_t cases[HISTO_NB_CASES];
+        uint64_t nb;          // Nombre de valeurs
+        uint64_t max;         // Plus grande valeur (exacte)
+        double somme;         // Pour la moyenne
+        double sommeCarres;   // Pour l'écart-type
+    };
+
+    // Vide l'histogramme
+    void histoReinitialiser(struct histogramme *h);
+
+    // Ajoute une valeur
+    void histoAjouter(struct histogramme *h, uint64_t valeur);
+
+    // Ajoute toutes les valeurs de source à h (par exemple, les histogrammes de
+    // plusieurs fils ou processus)
+    void histoFusionner(struct histogramme *h, const struct histogramme *source);
+
+    // Valeur sous laquelle se trouvent p % des valeurs (p entre 0 et 100); borne
+    // supérieure de la case atteinte, sans dépasser le maximum observé. 0 si vide.
+    uint64_t histoPercentile(const struct histogramme *h, double p);
+
+    // Moyenne et écart-type des valeurs (0 si vide)
+    double histoMoyenne(const struct histogramme *h);
+    double histoEcartType(const struct histogramme *h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
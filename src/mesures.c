@@ -0,0 +1,106 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier implémentant les outils communs aux programmes de mesure
+ ******************************************************************************/
+
+#include "mesures.h"
+
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+int ouvrirSortieMesures(struct sortieMesures *s, const char *nom,
+                        const char *const *colonnes, int nbColonnes,
+                        const char *nomProgramme) {
+  memset(s, 0, sizeof(*s));
+  s->colonnes = colonnes;
+  s->nbColonnes = nbColonnes;
+  if (nom == NULL)
+    return 0;
+
+  s->f = fopen(nom, "w");
+  if (s->f == NULL) {
+    fprintf(stderr, "[%s] ", nomProgramme);
+    perror(nom);
+    return -1;
+  }
+  size_t n = strlen(nom);
+  s->json = (n >= 5 && strcmp(nom + n - 5, ".json") == 0);
+  if (!s->json) {
+    for (int i = 0; i < nbColonnes; i++)
+      fprintf(s->f, "%s%s", (i > 0) ? "," : "", colonnes[i]);
+    fprintf(s->f, "\n");
+    fflush(s->f);
+  }
+  return 0;
+}
+
+// Séparateur et, en JSON, clé de la colonne suivante
+static void debutValeur(struct sortieMesures *s) {
+  const char *nom =
+      (s->colonne < s->nbColonnes) ? s->colonnes[s->colonne] : "?";
+  if (s->json)
+    fprintf(s->f, "%s\"%s\": ", (s->colonne == 0) ? "{" : ", ", nom);
+  else if (s->colonne > 0)
+    fputc(',', s->f);
+  s->colonne++;
+}
+
+void mesureNombre(struct sortieMesures *s, const char *format, ...) {
+  if (s->f == NULL)
+    return;
+  debutValeur(s);
+  va_list args;
+  va_start(args, format);
+  vfprintf(s->f, format, args);
+  va_end(args);
+}
+
+void mesureTexte(struct sortieMesures *s, const char *texte) {
+  if (s->f == NULL)
+    return;
+  debutValeur(s);
+  fprintf(s->f, s->json ? "\"%s\"" : "%s", texte);
+}
+
+void mesureBooleen(struct sortieMesures *s, int valeur) {
+  if (s->f == NULL)
+    return;
+  debutValeur(s);
+  if (s->json)
+    fputs(valeur ? "true" : "false", s->f);
+  else
+    fputc(valeur ? '1' : '0', s->f);
+}
+
+void mesureAbsente(struct sortieMesures *s) {
+  if (s->f == NULL)
+    return;
+  debutValeur(s);
+  if (s->json)
+    fputs("null", s->f);
+}
+
+void finLigneMesures(struct sortieMesures *s) {
+  if (s->f == NULL)
+    return;
+  fputs(s->json ? "}\n" : "\n", s->f);
+  fflush(s->f);
+  s->colonne = 0;
+}
+
+void fermerSortieMesures(struct sortieMesures *s) {
+  if (s->f != NULL)
+    fclose(s->f);
+  s->f = NULL;
+}
+
+uint64_t maintenantNs(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
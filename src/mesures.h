@@ -0,0 +1,70 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier de déclaration des outils communs aux programmes qui écrivent des
+ * mesures (compositeur -S, benchNoyaux, benchIPC)
+ ******************************************************************************/
+
+#ifndef MESURES_H
+#define MESURES_H
+
+// Permet de protéger le header lorsqu'il est inclus par un fichier C++
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+
+/******************************************************************************
+ * SORTIE DES MESURES (option -S fichier)
+ * Les mesures sont écrites une ligne à la fois, en CSV (précédé d'une ligne
+ * d'en-tête avec le nom des colonnes), ou en JSON (un objet par ligne, les
+ * noms des colonnes comme clés) si le nom du fichier se termine par .json.
+ * Le programme ne fournit que ses colonnes, puis les valeurs de chaque ligne,
+ * dans l'ordre des colonnes. Le fichier est vidé à chaque fin de ligne : les
+ * lignes écrites restent lisibles si le programme est interrompu.
+ ******************************************************************************/
+    struct sortieMesures
+    {
+        FILE *f;                     // NULL si aucun fichier n'a été demandé
+        int json;
+        const char *const *colonnes; // Noms des colonnes
+        int nbColonnes;
+        int colonne;                 // Prochaine colonne de la ligne en cours
+    };
+
+    // Ouvre le fichier nom et écrit l'en-tête CSV. Si nom est NULL, la sortie reste
+    // fermée et les fonctions suivantes ne font rien. Retourne 0 en cas de succès, -1
+    // si le fichier ne peut pas être créé (l'erreur est affichée avec nomProgramme).
+    int ouvrirSortieMesures(struct sortieMesures *s, const char *nom,
+                            const char *const *colonnes, int nbColonnes,
+                            const char *nomProgramme);
+
+    // Valeur numérique de la colonne suivante, mise en forme comme par printf
+    void mesureNombre(struct sortieMesures *s, const char *format, ...)
+        __attribute__((format(printf, 2, 3)));
+
+    // Texte (entre guillemets en JSON), booléen (true/false en JSON, 1/0 en CSV) ou
+    // valeur absente (null en JSON, vide en CSV) de la colonne suivante
+    void mesureTexte(struct sortieMesures *s, const char *texte);
+    void mesureBooleen(struct sortieMesures *s, int valeur);
+    void mesureAbsente(struct sortieMesures *s);
+
+    // Termine la ligne en cours
+    void finLigneMesures(struct sortieMesures *s);
+
+    void fermerSortieMesures(struct sortieMesures *s);
+
+    // Temps CLOCK_MONOTONIC en nanosecondes
+    uint64_t maintenantNs(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
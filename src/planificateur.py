@@ -0,0 +1,309 @@
+# Planifie l'ordonnancement temps reel de tout un pipeline (decodeurs, etapes
+# de traitement, compositeur) a partir d'une description et des couts mesures
+# de chaque etape, puis produit les lignes de commande (ou les lance).
+#
+# Description (JSON) :
+# {
+#   "ordonnanceur": "FIFO",        RR, FIFO ou DEADLINE
+#   "cpus": 1,                     coeurs disponibles (defaut : 1)
+#   "utilisation_max": 0.95,       fraction de chaque coeur accordee au temps
+#                                  reel (sched_rt_runtime_us / sched_rt_period_us)
+#   "marge": 1.25,                 DEADLINE : runtime = cout * marge
+#   "flux": [
+#     {"fps": 24, "etapes": [
+#       {"programme": "decodeur", "args": ["160p/02_Sintel.ulv"], "cout_ms": 9.0},
+#       {"programme": "convertisseur", "cout_ms": 1.5},
+#       {"programme": "filtreur", "args": ["-f", "0"], "cout_ms": 6.0}
+#     ]}
+#   ],
+#   "compositeur": {"args": [], "cout_ms": 3.0}
+# }
+# La premiere etape d'un flux est toujours un decodeur. Les zones /mem1, /mem2,
+# ... sont attribuees dans l'ordre des flux et des etapes. cout_ms est le temps
+# CPU d'une etape par image (compositeur : par periode du flux le plus rapide),
+# par exemple la valeur p99 affichee par -s DEADLINE -d auto.
+#
+# RR / FIFO : priorites a taux monotone (rate-monotonic). Plus un flux est
+# rapide, plus ses etapes sont prioritaires; dans un flux, une etape en aval
+# est plus prioritaire qu'une etape en amont, pour qu'une image en cours soit
+# terminee avant que la suivante ne soit commencee (une seule image en vol par
+# zone). Le compositeur est au-dessus de tout. Les priorites descendent a
+# partir de PRIORITE_MAX; 99 reste libre. Sur un coeur, l'ordonnancabilite est
+# verifiee par analyse du temps de reponse; sur plusieurs, seule l'utilisation
+# totale est verifiee.
+# DEADLINE : runtime = cout * marge (arrondi a la ms superieure),
+# deadline = period = 1 / fps; l'utilisation totale doit passer le test
+# d'admission du noyau.
+#
+# --placement : affinite (-c) de chaque programme. Le dernier coeur est reserve
+# au compositeur; chaque flux recoit ensuite, a tour de role, un groupe de
+# coeurs partageant un cache (lu dans /sys/devices/system/cpu), pour que le
+# producteur et le consommateur d'une zone se passent les images par ce cache.
+# Avec un seul coeur, aucune affinite n'est imposee. Avec DEADLINE, le noyau
+# exige un cpuset exclusif par groupe (cgroup) pour accepter ces affinites.
+#
+# Usage
+# python planificateur.py pipeline.json > script.bash
+# python planificateur.py pipeline.json --appliquer --executables=build/
+# python planificateur.py pipeline.json --placement > script.bash
+
+import argparse
+import json
+import math
+import os
+import subprocess
+import sys
+import time
+from pathlib import Path
+
+PRIORITE_MAX = 90
+UTILISATION_MAX_DEFAUT = 0.95
+MARGE_DEFAUT = 1.25
+
+
+class Tache:
+    def __init__(self, programme, args, cout_ms, fps, profondeur, entrees, sortie):
+        self.programme = programme
+        self.args = [str(a) for a in args]
+        self.cout_ms = float(cout_ms)
+        self.fps = float(fps)
+        self.profondeur = profondeur
+        self.entrees = entrees
+        self.sortie = sortie
+        self.priorite = None
+        self.runtime_ms = None
+        self.periode_deadline_ms = None
+        self.flux = None
+        self.coeurs = None
+
+    @property
+    def periode_ms(self):
+        return 1000.0 / self.fps
+
+    @property
+    def utilisation(self):
+        return self.cout_ms / self.periode_ms
+
+
+def lire_pipeline(description):
+    taches = []
+    sorties_finales = []
+    zone = 0
+    for flux in description["flux"]:
+        fps = flux["fps"]
+        entree = None
+        for profondeur, etape in enumerate(flux["etapes"]):
+            zone += 1
+            sortie = f"/mem{zone}"
+            taches.append(Tache(etape["programme"], etape.get("args", []),
+                                etape["cout_ms"], fps, profondeur,
+                                [entree] if entree else [], sortie))
+            taches[-1].flux = len(sorties_finales)
+            entree = sortie
+        sorties_finales.append(entree)
+
+    compositeur = description["compositeur"]
+    fps_max = max(f["fps"] for f in description["flux"])
+    profondeur_max = max(len(f["etapes"]) for f in description["flux"])
+    taches.append(Tache("compositeur", compositeur.get("args", []),
+                        compositeur["cout_ms"], fps_max, profondeur_max,
+                        sorties_finales, None))
+    return taches
+
+
+def attribuer_priorites(taches):
+    # Une priorite par couple (fps, profondeur), du plus rapide et du plus en
+    # aval au plus lent et au plus en amont
+    cles = sorted({(t.fps, t.profondeur) for t in taches}, reverse=True)
+    if len(cles) > PRIORITE_MAX:
+        sys.exit(f"Trop de niveaux de priorite ({len(cles)})")
+    priorites = {cle: PRIORITE_MAX - rang for rang, cle in enumerate(cles)}
+    for t in taches:
+        t.priorite = priorites[(t.fps, t.profondeur)]
+
+
+def temps_reponse(taches):
+    # Analyse du temps de reponse sur un coeur (echeance = periode). Les taches
+    # de meme priorite sont comptees comme interferences (pire cas en RR/FIFO).
+    resultats = {}
+    for t in taches:
+        autres = [a for a in taches if a is not t and a.priorite >= t.priorite]
+        r = t.cout_ms
+        while True:
+            suivant = t.cout_ms + sum(math.ceil(r / a.periode_ms) * a.cout_ms
+                                      for a in autres)
+            if suivant > t.periode_ms or abs(suivant - r) < 1e-9:
+                r = suivant
+                break
+            r = suivant
+        resultats[t] = r
+    return resultats
+
+
+def verifier_priorites(taches, cpus, utilisation_max):
+    utilisation = sum(t.utilisation for t in taches)
+    capacite = cpus * utilisation_max
+    print(f"# Utilisation totale : {utilisation:.3f} (capacite : {capacite:.3f})",
+          file=sys.stderr)
+    ok = utilisation <= capacite
+    if cpus == 1:
+        n = len(taches)
+        borne = n * (2 ** (1.0 / n) - 1)
+        print(f"# Borne de Liu et Layland pour {n} taches : {borne:.3f}",
+              file=sys.stderr)
+        reponses = temps_reponse(taches)
+        for t in taches:
+            r = reponses[t]
+            etat = "ok" if r <= t.periode_ms else "ECHEANCE MANQUEE"
+            print(f"#   {t.programme:16s} prio {t.priorite:2d}  C={t.cout_ms:6.2f} ms"
+                  f"  T={t.periode_ms:6.2f} ms  R={r:7.2f} ms  {etat}",
+                  file=sys.stderr)
+            ok = ok and r <= t.periode_ms
+    return ok
+
+
+def attribuer_budgets(taches, marge, cpus, utilisation_max):
+    utilisation = 0.0
+    for t in taches:
+        periode = max(1, int(t.periode_ms))
+        t.runtime_ms = max(1, math.ceil(t.cout_ms * marge))
+        t.periode_deadline_ms = periode
+        utilisation += t.runtime_ms / periode
+        etat = "ok" if t.runtime_ms <= periode else "RUNTIME > PERIODE"
+        print(f"#   {t.programme:16s} -d {t.runtime_ms},{periode},{periode}  {etat}",
+              file=sys.stderr)
+    capacite = cpus * utilisation_max
+    print(f"# Bande passante reservee : {utilisation:.3f} (capacite : {capacite:.3f})",
+          file=sys.stderr)
+    return utilisation <= capacite and all(t.runtime_ms <= t.periode_deadline_ms
+                                           for t in taches)
+
+
+def groupes_cache():
+    # Groupes de coeurs partageant le cache de plus haut niveau (L2 ou L3)
+    groupes = {}
+    for cpu in sorted(Path("/sys/devices/system/cpu").glob("cpu[0-9]*")):
+        caches = sorted(cpu.glob("cache/index*"),
+                        key=lambda c: int((c / "level").read_text()))
+        if not caches:
+            continue
+        partage = (caches[-1] / "shared_cpu_list").read_text().strip()
+        groupes.setdefault(partage, set()).add(int(cpu.name[3:]))
+    if not groupes:
+        return [set(range(os.cpu_count() or 1))]
+    return sorted(groupes.values(), key=min)
+
+
+def texte_coeurs(coeurs):
+    return ",".join(str(c) for c in sorted(coeurs))
+
+
+def attribuer_coeurs(taches):
+    groupes = groupes_cache()
+    tous = set().union(*groupes)
+    if len(tous) < 2:
+        print("# Un seul coeur : aucune affinite imposee", file=sys.stderr)
+        return
+    coeur_compositeur = max(tous)
+    groupes = [g - {coeur_compositeur} for g in groupes]
+    groupes = [g for g in groupes if g]
+    for t in taches:
+        if t.programme == "compositeur":
+            t.coeurs = {coeur_compositeur}
+        else:
+            t.coeurs = groupes[t.flux % len(groupes)]
+        print(f"#   {t.programme:16s} {t.sortie or '':6s} -c {texte_coeurs(t.coeurs)}",
+              file=sys.stderr)
+
+
+def ligne_commande(t, ordonnanceur, executables):
+    cmd = [os.path.join(executables, t.programme)]
+    if ordonnanceur == "DEADLINE":
+        p = t.periode_deadline_ms
+        cmd += ["-s", "DEADLINE", "-d", f"{t.runtime_ms},{p},{p}"]
+    else:
+        cmd += ["-s", f"{ordonnanceur}:{t.priorite}"]
+    if t.coeurs:
+        cmd += ["-c", texte_coeurs(t.coeurs)]
+    cmd += t.args
+    if t.programme == "decodeur":
+        cmd += [t.sortie]
+    elif t.sortie is not None:
+        cmd += t.entrees + [t.sortie]
+    else:
+        cmd += t.entrees
+    return cmd
+
+
+def ecrire_script(taches, ordonnanceur, executables):
+    print("#!/bin/bash")
+    print()
+    print("# Genere par planificateur.py")
+    print()
+    print("sudo rm /dev/shm/mem*")
+    for t in taches:
+        for zone in t.entrees:
+            print(f"while [ ! -f /dev/shm{zone} ]; do sleep 0.05; done")
+        print("sudo " + " ".join(ligne_commande(t, ordonnanceur, executables)) + " &")
+    print("wait;")
+
+
+def appliquer(taches, ordonnanceur, executables):
+    for f in Path("/dev/shm").glob("mem*"):
+        f.unlink()
+    processus = []
+    for t in taches:
+        for zone in t.entrees:
+            while not os.path.exists("/dev/shm" + zone):
+                time.sleep(0.05)
+        cmd = ligne_commande(t, ordonnanceur, executables)
+        print("[planificateur] " + " ".join(cmd), file=sys.stderr)
+        processus.append(subprocess.Popen(cmd))
+    for p in processus:
+        p.wait()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        prog="Planificateur d'ordonnancement temps reel, Labo 3 SETR"
+    )
+    parser.add_argument("description", type=Path,
+                        help="Description du pipeline (JSON)")
+    parser.add_argument("--executables", type=str, default=".",
+                        help="Dossier contenant les executables (defaut : .)")
+    parser.add_argument("--appliquer", action="store_true",
+                        help="Lancer le pipeline plutot qu'ecrire le script")
+    parser.add_argument("--placement", action="store_true",
+                        help="Attribuer des coeurs a chaque programme (-c)")
+    parser.add_argument("--forcer", action="store_true",
+                        help="Continuer meme si le pipeline n'est pas ordonnancable")
+    args = parser.parse_args()
+
+    with open(args.description) as f:
+        description = json.load(f)
+    ordonnanceur = description.get("ordonnanceur", "FIFO")
+    if ordonnanceur not in ("RR", "FIFO", "DEADLINE"):
+        sys.exit(f"Ordonnanceur {ordonnanceur} non valide (RR, FIFO, DEADLINE)")
+    cpus = description.get("cpus", 1)
+    utilisation_max = description.get("utilisation_max", UTILISATION_MAX_DEFAUT)
+
+    taches = lire_pipeline(description)
+    if ordonnanceur == "DEADLINE":
+        ok = attribuer_budgets(taches, description.get("marge", MARGE_DEFAUT),
+                               cpus, utilisation_max)
+    else:
+        attribuer_priorites(taches)
+        ok = verifier_priorites(taches, cpus, utilisation_max)
+
+    if not ok:
+        print("# Pipeline NON ordonnancable", file=sys.stderr)
+        if not args.forcer:
+            sys.exit(1)
+
+    if args.placement:
+        attribuer_coeurs(taches)
+
+    if args.appliquer:
+        appliquer(taches, ordonnanceur, args.executables)
+    else:
+        ecrire_script(taches, ordonnanceur, args.executables)
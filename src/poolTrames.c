@@ -0,0 +1,242 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier implémentant le pool de trames partagé et le canal de poignées
+ ******************************************************************************/
+
+#include "poolTrames.h"
+
+#define ARRONDIR(x, a) (((x) + (a)-1) / (a) * (a))
+
+// Les cases commencent après le header, alignées sur POOL_ALIGNEMENT
+static size_t offsetTrames(void) {
+  return ARRONDIR(sizeof(struct poolTramesHeader), POOL_ALIGNEMENT);
+}
+
+/* -------------------------------------------------------------------------- *
+ *  initPoolTramesCreateur
+ *  Crée, mappe et verrouille en mémoire le segment du pool.
+ * -------------------------------------------------------------------------- */
+int initPoolTramesCreateur(const char *identifiant, struct poolTrames *pool,
+                           size_t tailleTrame, uint32_t nbTrames) {
+  if (nbTrames == 0 || nbTrames > POOL_NB_TRAMES_MAX || tailleTrame == 0) {
+    fprintf(stderr, "initPoolTramesCreateur: %u cases invalide (max %d)\n",
+            nbTrames, POOL_NB_TRAMES_MAX);
+    return -1;
+  }
+
+  pool->fd = shm_open(identifiant, O_CREAT | O_RDWR | O_TRUNC, 0666);
+  if (pool->fd == -1) {
+    perror("initPoolTramesCreateur: shm_open");
+    return -1;
+  }
+
+  size_t tailleCase = ARRONDIR(tailleTrame, POOL_ALIGNEMENT);
+  size_t tailleTotale = offsetTrames() + tailleCase * nbTrames;
+
+  if (ftruncate(pool->fd, (off_t)tailleTotale) == -1) {
+    perror("initPoolTramesCreateur: ftruncate");
+    return -1;
+  }
+
+  void *ptr = mmap(NULL, tailleTotale, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   pool->fd, 0);
+  if (ptr == MAP_FAILED) {
+    perror("initPoolTramesCreateur: mmap");
+    return -1;
+  }
+  if (mlock(ptr, tailleTotale) == -1)
+    perror("initPoolTramesCreateur: mlock");
+
+  snprintf(pool->nom, POOL_NOM_MAX, "%s", identifiant);
+  pool->header = (struct poolTramesHeader *)ptr;
+  pool->trames = (unsigned char *)ptr + offsetTrames();
+  pool->tailleTotale = tailleTotale;
+
+  pool->header->nbTrames = nbTrames;
+  pool->header->tailleTrame = (uint32_t)tailleCase;
+  pool->header->prochaine = 0;
+  for (uint32_t i = 0; i < POOL_NB_TRAMES_MAX; i++)
+    pool->header->references[i] = 0;
+
+  __atomic_store_n(&pool->header->etat, ETAT_PRET_SANS_DONNEES,
+                   __ATOMIC_RELEASE);
+  return 0;
+}
+
+/* -------------------------------------------------------------------------- *
+ *  initPoolTramesLecteur
+ *  Ouvre et mappe un pool existant, une fois son initialisation terminée.
+ * -------------------------------------------------------------------------- */
+int initPoolTramesLecteur(const char *identifiant, struct poolTrames *pool) {
+  while ((pool->fd = shm_open(identifiant, O_RDWR, 0)) == -1) {
+    if (errno == ENOENT) {
+      usleep(DELAI_INIT_READER_USEC);
+      continue;
+    }
+    perror("initPoolTramesLecteur: shm_open");
+    return -1;
+  }
+
+  struct stat st;
+  do {
+    if (fstat(pool->fd, &st) == -1) {
+      perror("initPoolTramesLecteur: fstat");
+      return -1;
+    }
+    if (st.st_size < (off_t)offsetTrames())
+      usleep(DELAI_INIT_READER_USEC);
+  } while (st.st_size < (off_t)offsetTrames());
+
+  struct poolTramesHeader *hdr =
+      mmap(NULL, sizeof(struct poolTramesHeader), PROT_READ | PROT_WRITE,
+           MAP_SHARED, pool->fd, 0);
+  if (hdr == MAP_FAILED) {
+    perror("initPoolTramesLecteur: mmap header");
+    return -1;
+  }
+
+  while (__atomic_load_n(&hdr->etat, __ATOMIC_ACQUIRE) == ETAT_NON_INITIALISE)
+    usleep(DELAI_INIT_READER_USEC);
+
+  size_t tailleTotale =
+      offsetTrames() + (size_t)hdr->tailleTrame * hdr->nbTrames;
+  munmap(hdr, sizeof(struct poolTramesHeader));
+
+  void *ptr = mmap(NULL, tailleTotale, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   pool->fd, 0);
+  if (ptr == MAP_FAILED) {
+    perror("initPoolTramesLecteur: mmap complet");
+    return -1;
+  }
+  if (mlock(ptr, tailleTotale) == -1)
+    perror("initPoolTramesLecteur: mlock");
+
+  snprintf(pool->nom, POOL_NOM_MAX, "%s", identifiant);
+  pool->header = (struct poolTramesHeader *)ptr;
+  pool->trames = (unsigned char *)ptr + offsetTrames();
+  pool->tailleTotale = tailleTotale;
+  return 0;
+}
+
+void fermerPoolTrames(struct poolTrames *pool) {
+  if (pool->header == NULL)
+    return;
+  munlock(pool->header, pool->tailleTotale);
+  munmap(pool->header, pool->tailleTotale);
+  close(pool->fd);
+  memset(pool, 0, sizeof(*pool));
+}
+
+/* -------------------------------------------------------------------------- *
+ *  acquerirTrame
+ *  Cherche une case dont le compteur est à zéro et le passe à un (CAS).
+ *  La recherche commence après la dernière case attribuée, pour éviter de
+ *  toujours réutiliser les mêmes cases (et de faire attendre un lecteur qui
+ *  n'a pas encore relâché la précédente).
+ * -------------------------------------------------------------------------- */
+int acquerirTrame(struct poolTrames *pool) {
+  struct poolTramesHeader *hdr = pool->header;
+  uint32_t n = hdr->nbTrames;
+  uint32_t depart = __atomic_load_n(&hdr->prochaine, __ATOMIC_RELAXED);
+
+  for (uint32_t k = 0; k < n; k++) {
+    uint32_t i = (depart + k) % n;
+    uint32_t attendu = 0;
+    if (__atomic_compare_exchange_n(&hdr->references[i], &attendu, 1, 0,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      __atomic_store_n(&hdr->prochaine, (i + 1) % n, __ATOMIC_RELAXED);
+      return (int)i;
+    }
+  }
+  return POOL_TRAME_INVALIDE;
+}
+
+void retenirTrame(struct poolTrames *pool, int indice) {
+  __atomic_add_fetch(&pool->header->references[indice], 1, __ATOMIC_RELAXED);
+}
+
+void relacherTrame(struct poolTrames *pool, int indice) {
+  uint32_t restant = __atomic_sub_fetch(&pool->header->references[indice], 1,
+                                        __ATOMIC_RELEASE);
+  if (restant == UINT32_MAX) {
+    // Relâchement en trop : on remet le compteur à zéro plutôt que de
+    // bloquer la case pour toujours
+    fprintf(stderr, "relacherTrame: case %d relâchée en trop\n", indice);
+    __atomic_store_n(&pool->header->references[indice], 0, __ATOMIC_RELEASE);
+  }
+}
+
+unsigned char *donneesTrame(const struct poolTrames *pool, int indice) {
+  return pool->trames + (size_t)indice * pool->header->tailleTrame;
+}
+
+/* -------------------------------------------------------------------------- *
+ *  initCanalPoigneesEcrivain
+ *  Le canal est une zone memPartage ordinaire contenant une poigneeTrame.
+ * -------------------------------------------------------------------------- */
+int initCanalPoigneesEcrivain(const char *identifiant,
+                              struct canalPoignees *canal,
+                              struct videoInfos *infos,
+                              struct poolTrames *pool) {
+  canal->pool = pool;
+  // Une poignée écrasée sans être lue laisserait sa case réservée pour
+  // toujours, et une poignée diffusée n'a qu'une référence : le canal reste en
+  // POLITIQUE_BLOQUANTE à un seul lecteur quelles que soient les options -p et -n
+  struct optionsCanal options = optionsCanalDefaut;
+  optionsCanalDefaut.politique = POLITIQUE_BLOQUANTE;
+  optionsCanalDefaut.nbLecteurs = 1;
+  int ret = initMemoirePartageeEcrivainTaille(identifiant, &canal->zone, infos,
+                                              sizeof(struct poigneeTrame));
+  optionsCanalDefaut = options;
+  return ret;
+}
+
+/* -------------------------------------------------------------------------- *
+ *  initCanalPoigneesLecteur
+ *  Le pool est ouvert paresseusement dans recevoirPoignee : son nom n'est
+ *  connu qu'à la réception de la première poignée.
+ * -------------------------------------------------------------------------- */
+int initCanalPoigneesLecteur(const char *identifiant,
+                             struct canalPoignees *canal,
+                             struct poolTrames *pool) {
+  memset(pool, 0, sizeof(*pool));
+  canal->pool = pool;
+  return initMemoirePartageeLecteur(identifiant, &canal->zone);
+}
+
+void envoyerPoignee(struct canalPoignees *canal, int indice) {
+  attenteEcrivain(&canal->zone);
+  struct poigneeTrame *p = (struct poigneeTrame *)canal->zone.data;
+  memcpy(p->nomPool, canal->pool->nom, POOL_NOM_MAX);
+  p->indice = indice;
+  signalEcrivain(&canal->zone);
+}
+
+int recevoirPoignee(struct canalPoignees *canal) {
+  attenteLecteur(&canal->zone);
+  struct poigneeTrame p = *(struct poigneeTrame *)canal->zone.data;
+  signalLecteur(&canal->zone);
+
+  p.nomPool[POOL_NOM_MAX - 1] = '\0';
+  if (canal->pool->header != NULL &&
+      strncmp(p.nomPool, canal->pool->nom, POOL_NOM_MAX) != 0)
+    fermerPoolTrames(canal->pool);
+  if (canal->pool->header == NULL &&
+      initPoolTramesLecteur(p.nomPool, canal->pool) != 0)
+    return POOL_TRAME_INVALIDE;
+
+  if (p.indice < 0 || (uint32_t)p.indice >= canal->pool->header->nbTrames) {
+    // Le compteur existe pour toute case du header : la référence transférée
+    // par l'écrivain ne doit pas rester prise
+    fprintf(stderr, "recevoirPoignee: case %d hors du pool %s\n", p.indice,
+            p.nomPool);
+    if (p.indice >= 0 && p.indice < POOL_NB_TRAMES_MAX)
+      relacherTrame(canal->pool, p.indice);
+    return POOL_TRAME_INVALIDE;
+  }
+  return p.indice;
+}
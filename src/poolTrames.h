@@ -0,0 +1,136 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier de déclaration du pool de trames partagé entre les programmes et
+ * du canal de poignées qui permet de se passer ces trames par référence.
+ ******************************************************************************/
+
+#ifndef POOL_TRAMES_H
+#define POOL_TRAMES_H
+
+// Permet de protéger le header lorsqu'il est inclus par un fichier C++
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "commMemoirePartagee.h"
+
+/******************************************************************************
+ * Un pool de trames est un unique segment de mémoire partagée (verrouillé en
+ * mémoire avec mlock) découpé en cases de taille fixe. Chaque case possède un
+ * compteur de références, manipulé de façon atomique par tous les processus
+ * qui ont ouvert le pool.
+ *
+ * Plutôt que de copier une image d'une zone à l'autre, un programme peut
+ * acquérir une case, y écrire son image, puis envoyer une _poignée_ (l'indice
+ * de la case) au programme suivant par l'intermédiaire d'un canal de poignées.
+ * Ce canal est une zone memPartage ordinaire (même synchronisation que pour les
+ * images) dont la zone de données ne contient qu'une struct poigneeTrame.
+ *
+ * Règles de propriété :
+ * - acquerirTrame() retourne une case dont l'appelant détient la seule référence;
+ * - envoyerPoignee() transfère la référence de l'appelant au destinataire;
+ * - recevoirPoignee() retourne une case dont l'appelant détient une référence;
+ * - relacherTrame() abandonne une référence (la case redevient libre à zéro).
+ * Un programme qui ne modifie pas les pixels (ou qui les modifie sur place)
+ * peut donc simplement faire suivre la poignée reçue. Pour envoyer la même case
+ * à plusieurs destinataires, on appelle retenirTrame() une fois par
+ * destinataire supplémentaire.
+ ******************************************************************************/
+
+#define POOL_NB_TRAMES_MAX 64
+#define POOL_ALIGNEMENT 64
+#define POOL_NOM_MAX 32
+#define POOL_TRAME_INVALIDE (-1)
+
+    // Header situé au début du segment partagé du pool
+    struct poolTramesHeader
+    {
+        volatile uint32_t etat;                             // ETAT_NON_INITIALISE tant que le créateur n'a pas terminé
+        uint32_t nbTrames;                                  // Nombre de cases du pool
+        uint32_t tailleTrame;                               // Taille d'une case (octets, multiple de POOL_ALIGNEMENT)
+        uint32_t prochaine;                                 // Case où commencer la prochaine recherche (indicatif)
+        volatile uint32_t references[POOL_NB_TRAMES_MAX];   // Compteur de références de chaque case
+    };
+
+    // Informations locales (propres au processus) sur un pool ouvert
+    struct poolTrames
+    {
+        int fd;                           // Descripteur retourné par shm_open
+        char nom[POOL_NOM_MAX];           // Identifiant du segment (ex. "/pool1")
+        struct poolTramesHeader *header;  // Pointeur vers le header dans la mémoire partagée
+        unsigned char *trames;            // Pointeur vers la première case
+        size_t tailleTotale;              // Taille totale du segment mappé
+    };
+
+    // Contenu de la zone de données d'un canal de poignées
+    struct poigneeTrame
+    {
+        char nomPool[POOL_NOM_MAX]; // Pool d'où provient la case
+        int32_t indice;             // Indice de la case dans ce pool
+    };
+
+    // Canal de poignées : une zone memPartage et le pool associé
+    struct canalPoignees
+    {
+        struct memPartage zone;  // Zone dont les données sont une struct poigneeTrame
+        struct poolTrames *pool; // Pool d'où proviennent (écrivain) ou vers lequel pointent (lecteur) les poignées
+    };
+
+    // Crée le pool (nbTrames cases d'au moins tailleTrame octets) et le verrouille en mémoire.
+    // Retourne 0 en cas de succès, -1 en cas d'erreur.
+    int initPoolTramesCreateur(const char *identifiant, struct poolTrames *pool,
+                               size_t tailleTrame, uint32_t nbTrames);
+
+    // Ouvre un pool créé par un autre processus. Attend que le créateur ait terminé son
+    // initialisation, de la même façon que initMemoirePartageeLecteur.
+    // Retourne 0 en cas de succès, -1 en cas d'erreur.
+    int initPoolTramesLecteur(const char *identifiant, struct poolTrames *pool);
+
+    // Démappe le pool (sans le détruire : le créateur appelle shm_unlink au besoin)
+    void fermerPoolTrames(struct poolTrames *pool);
+
+    // Réserve une case libre (compteur de références à 1). Ne bloque jamais : retourne
+    // POOL_TRAME_INVALIDE si toutes les cases sont utilisées.
+    int acquerirTrame(struct poolTrames *pool);
+
+    // Ajoute une référence à une case déjà détenue par l'appelant
+    void retenirTrame(struct poolTrames *pool, int indice);
+
+    // Abandonne une référence; la case redevient libre lorsque le compteur atteint zéro
+    void relacherTrame(struct poolTrames *pool, int indice);
+
+    // Retourne un pointeur vers les données de la case
+    unsigned char *donneesTrame(const struct poolTrames *pool, int indice);
+
+    // Crée un canal de poignées (côté écrivain) dont les poignées proviennent de pool.
+    // infos décrit le format des images contenues dans les cases.
+    int initCanalPoigneesEcrivain(const char *identifiant, struct canalPoignees *canal,
+                                  struct videoInfos *infos, struct poolTrames *pool);
+
+    // Ouvre un canal de poignées (côté lecteur). pool doit pointer vers une struct vide :
+    // le pool indiqué par l'écrivain y est ouvert à la réception de la première poignée.
+    int initCanalPoigneesLecteur(const char *identifiant, struct canalPoignees *canal,
+                                 struct poolTrames *pool);
+
+    // Envoie la case indice au lecteur (bloque comme attenteEcrivain si la poignée
+    // précédente n'a pas encore été lue). La référence de l'appelant est transférée.
+    void envoyerPoignee(struct canalPoignees *canal, int indice);
+
+    // Attend la prochaine poignée et retourne l'indice de la case reçue (l'appelant en
+    // détient alors une référence), ou POOL_TRAME_INVALIDE en cas d'erreur (la référence
+    // est alors relâchée). Si l'écrivain change de pool, le nouveau est ouvert à la place
+    // de l'ancien.
+    int recevoirPoignee(struct canalPoignees *canal);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
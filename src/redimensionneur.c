@@ -16,12 +16,8 @@
 int main(int argc, char *argv[]) {
   setbuf(stdout, NULL);
 
-  char signatureProfilage[128] = {0};
-  char *nomProgramme = (argv[0][0] == '.') ? argv[0] + 2 : argv[0];
-  snprintf(signatureProfilage, 128, "profilage-%s-%u.txt", nomProgramme,
-           (unsigned int)getpid());
   InfosProfilage profInfos;
-  initProfilage(&profInfos, signatureProfilage);
+  initProfilage(&profInfos, argv[0]);
   evenementProfilage(&profInfos, ETAT_INITIALISATION);
 
   struct SchedParams params = {
@@ -45,14 +41,8 @@ int main(int argc, char *argv[]) {
   } else {
     int c;
     opterr = 0;
-    while ((c = getopt(argc, argv, "s:d:w:h:r:")) != -1) {
+    while ((c = getopt(argc, argv, OPTIONS_COMMUNES "w:h:r:")) != -1) {
       switch (c) {
-      case 's':
-        parseSchedOption(optarg, &params);
-        break;
-      case 'd':
-        parseDeadlineParams(optarg, &params);
-        break;
       case 'w':
         outWidth = (unsigned int)atoi(optarg);
         break;
@@ -63,6 +53,7 @@ int main(int argc, char *argv[]) {
         methode = atoi(optarg);
         break;
       default:
+        parseOptionCommune(c, optarg, &params);
         break;
       }
     }
@@ -90,12 +81,14 @@ int main(int argc, char *argv[]) {
   uint32_t haut = zoneEntree.header->infos.hauteur;
   uint32_t canaux = zoneEntree.header->infos.canaux;
   uint32_t fps = zoneEntree.header->infos.fps;
+  uint32_t format = formatVideo(&zoneEntree.header->infos);
 
   struct videoInfos infosOut;
   infosOut.largeur = outWidth;
   infosOut.hauteur = outHeight;
   infosOut.canaux = canaux;
   infosOut.fps = fps;
+  infosOut.format = format;
   struct memPartage zoneSortie;
   if (initMemoirePartageeEcrivain(sortie, &zoneSortie, &infosOut) != 0) {
     fprintf(stderr, "[redimensionneur] Échec initMemoirePartageeEcrivain(%s)\n",
@@ -103,20 +96,42 @@ int main(int argc, char *argv[]) {
     return -1;
   }
 
-  size_t tailleEntree = (size_t)larg * haut * canaux;
-  size_t tailleSortie = (size_t)outWidth * outHeight * canaux;
-
-  prepareMemoire(tailleEntree, tailleSortie * 4);
+  size_t tailleEntree = tailleImageVideo(&zoneEntree.header->infos);
+  size_t tailleSortie = tailleImageVideo(&infosOut);
+
+  // Les formats planaires sont redimensionnés plan par plan; les plans de
+  // chrominance ont leurs propres dimensions, donc leur propre grille
+  struct planImage plansEntree[PLANS_MAX], plansSortie[PLANS_MAX];
+  int nbPlans = plansImage(format, larg, haut, plansEntree);
+  plansImage(format, outWidth, outHeight, plansSortie);
+
+  // Un gros bloc doit aussi contenir un tableau de la grille (4 octets par
+  // pixel de sortie), plus grand qu'une image 4:2:0
+  size_t tailleGrille = (size_t)outWidth * outHeight * sizeof(float);
+  prepareMemoire(tailleEntree, (tailleSortie * 4 > tailleGrille)
+                                   ? tailleSortie * 4
+                                   : tailleGrille);
   struct rlimit rl = {RLIM_INFINITY, RLIM_INFINITY};
   setrlimit(RLIMIT_MEMLOCK, &rl);
   mlockall(MCL_CURRENT | MCL_FUTURE);
+  initCalibration(&profInfos, &params, fps, "redimensionneur");
   appliquerOrdonnancement(&params, "redimensionneur");
 
-  ResizeGrid rg;
-  if (methode == 0)
-    rg = resizeNearestNeighborInit(outHeight, outWidth, haut, larg);
-  else
-    rg = resizeBilinearInit(outHeight, outWidth, haut, larg);
+  ResizeGrid grilles[PLANS_MAX];
+  for (int p = 0; p < nbPlans; p++) {
+    if (p > 1) { // En I420, V a les dimensions de U
+      grilles[p] = grilles[1];
+      continue;
+    }
+    if (methode == 0)
+      grilles[p] = resizeNearestNeighborInit(
+          plansSortie[p].hauteur, plansSortie[p].largeur,
+          plansEntree[p].hauteur, plansEntree[p].largeur);
+    else
+      grilles[p] = resizeBilinearInit(
+          plansSortie[p].hauteur, plansSortie[p].largeur,
+          plansEntree[p].hauteur, plansEntree[p].largeur);
+  }
 
   unsigned char *bufEntree =
       (unsigned char *)tempsreel_malloc(tailleEntree);
@@ -137,13 +152,19 @@ int main(int argc, char *argv[]) {
     evenementProfilage(&profInfos, ETAT_TRAITEMENT);
     memcpy(bufEntree, zoneEntree.data, tailleEntree);
     signalLecteur(&zoneEntree);
-
-    if (methode == 0)
-      resizeNearestNeighbor(bufEntree, haut, larg, bufSortie, outHeight,
-                            outWidth, rg, canaux);
-    else
-      resizeBilinear(bufEntree, haut, larg, bufSortie, outHeight, outWidth, rg,
-                     canaux);
+    propagerSautees(&zoneEntree, &zoneSortie);
+
+    for (int p = 0; p < nbPlans; p++) {
+      const struct planImage *pe = &plansEntree[p], *ps = &plansSortie[p];
+      if (methode == 0)
+        resizeNearestNeighbor(bufEntree + pe->decalage, pe->hauteur,
+                              pe->largeur, bufSortie + ps->decalage,
+                              ps->hauteur, ps->largeur, grilles[p], pe->canaux);
+      else
+        resizeBilinear(bufEntree + pe->decalage, pe->hauteur, pe->largeur,
+                       bufSortie + ps->decalage, ps->hauteur, ps->largeur,
+                       grilles[p], pe->canaux);
+    }
 
     evenementProfilage(&profInfos, ETAT_ATTENTE_MUTEXECRITURE);
     attenteEcrivain(&zoneSortie);
@@ -157,7 +178,8 @@ int main(int argc, char *argv[]) {
     }
   }
 
-  resizeDestroy(rg);
+  for (int p = 0; p < nbPlans && p < 2; p++)
+    resizeDestroy(grilles[p]);
   tempsreel_free(bufEntree);
   tempsreel_free(bufSortie);
   return 0;
@@ -5,6 +5,10 @@ for moy and max values from performance log files.
 
 Input format:
 [timestamp] Entree 1: moy=16.5 fps, max=128.3 ms | Entree 2: moy=16.7 fps, max=131.3 ms | ...
+
+When the compositeur also reports per-window percentiles of the inter-frame
+delay (p50=... p90=... p99=... p99.9=... ms, gigue=... ms, retards=N), the same
+statistics are computed for p99, p99.9, gigue and retards.
 """
 
 import sys
@@ -22,13 +26,24 @@ def parse_line(line):
     
     # Pattern to match each entree block
     entree_pattern = r'Entree\s+(\d+):\s+moy=([0-9.]+)\s+fps,\s+max=([0-9.]+)\s+ms'
+    # Optional percentile block (compositeur histogram)
+    percentile_pattern = (r'p99=([0-9.]+)\s+p99\.9=([0-9.]+)\s+ms,\s+gigue=([0-9.]+)\s+ms,'
+                          r'\s+retards=(\d+)')
     
-    matches = re.findall(entree_pattern, line)
-    for match in matches:
-        entree_num = int(match[0])
-        moy_val = float(match[1])
-        max_val = float(match[2])
-        results[entree_num] = {'moy': moy_val, 'max': max_val}
+    for block in line.split('|'):
+        match = re.search(entree_pattern, block)
+        if not match:
+            continue
+        entree_num = int(match.group(1))
+        results[entree_num] = {'moy': float(match.group(2)), 'max': float(match.group(3))}
+        extra = re.search(percentile_pattern, block)
+        if extra:
+            results[entree_num].update({
+                'p99': float(extra.group(1)),
+                'p99.9': float(extra.group(2)),
+                'gigue': float(extra.group(3)),
+                'retards': float(extra.group(4)),
+            })
     
     return results
 
@@ -59,8 +74,8 @@ def main():
     input_file = sys.argv[1]
     
     # Store all values for each entree
-    # {entree_num: {'moy': [values], 'max': [values]}}
-    data = defaultdict(lambda: {'moy': [], 'max': []})
+    # {entree_num: {'moy': [values], 'max': [values], ...}}
+    data = defaultdict(lambda: defaultdict(list))
     
     try:
         with open(input_file, 'r') as f:
@@ -79,8 +94,8 @@ def main():
         for line in lines:
             parsed = parse_line(line)
             for entree_num, values in parsed.items():
-                data[entree_num]['moy'].append(values['moy'])
-                data[entree_num]['max'].append(values['max'])
+                for key, value in values.items():
+                    data[entree_num][key].append(value)
     except FileNotFoundError:
         print(f"Error: File '{input_file}' not found.")
         sys.exit(1)
@@ -107,25 +122,17 @@ def main():
         print(f"\nEntree {entree_num} ({n_samples} samples)")
         print("-" * 40)
         
-        # Statistics for moy (fps)
-        moy_stats = compute_statistics(entree_data['moy'])
-        if moy_stats:
-            print(f"  moy (fps):")
-            print(f"    Average:        {moy_stats['average']:.2f}")
-            print(f"    Median:         {moy_stats['median']:.2f}")
-            print(f"    Std. Dev.:      {moy_stats['std_dev']:.2f}")
-            print(f"    5% Percentile:  {moy_stats['percentile_5']:.2f}")
-            print(f"    95% Percentile: {moy_stats['percentile_95']:.2f}")
-        
-        # Statistics for max (ms)
-        max_stats = compute_statistics(entree_data['max'])
-        if max_stats:
-            print(f"  max (ms):")
-            print(f"    Average:        {max_stats['average']:.2f}")
-            print(f"    Median:         {max_stats['median']:.2f}")
-            print(f"    Std. Dev.:      {max_stats['std_dev']:.2f}")
-            print(f"    5% Percentile:  {max_stats['percentile_5']:.2f}")
-            print(f"    95% Percentile: {max_stats['percentile_95']:.2f}")
+        units = [('moy', 'fps'), ('max', 'ms'), ('p99', 'ms'), ('p99.9', 'ms'),
+                 ('gigue', 'ms'), ('retards', 'frames')]
+        for key, unit in units:
+            stats = compute_statistics(entree_data.get(key, []))
+            if stats:
+                print(f"  {key} ({unit}):")
+                print(f"    Average:        {stats['average']:.2f}")
+                print(f"    Median:         {stats['median']:.2f}")
+                print(f"    Std. Dev.:      {stats['std_dev']:.2f}")
+                print(f"    5% Percentile:  {stats['percentile_5']:.2f}")
+                print(f"    95% Percentile: {stats['percentile_95']:.2f}")
     
     print("\n" + "=" * 80)
 
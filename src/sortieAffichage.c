@@ -0,0 +1,325 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier implémentant les sorties d'affichage du compositeur (framebuffer,
+ * sortie nulle, enregistrement dans des fichiers)
+ ******************************************************************************/
+
+#include "sortieAffichage.h"
+#include "conversionPixels.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* -------------------------------------------------------------------------- *
+ *  parseSortie
+ * -------------------------------------------------------------------------- */
+int parseSortie(const char *arg, struct sortieAffichage *sortie) {
+  memset(sortie, 0, sizeof(*sortie));
+  sortie->fd = -1;
+
+  if (strcmp(arg, "fb") == 0) {
+    sortie->type = SORTIE_FB;
+    return 0;
+  }
+  if (strcmp(arg, "null") == 0) {
+    sortie->type = SORTIE_NULLE;
+    return 0;
+  }
+  if (strncmp(arg, "fichier:", 8) == 0 && arg[8] != '\0') {
+    sortie->type = SORTIE_FICHIER;
+    sortie->periode = SORTIE_PERIODE_FICHIER_DEFAUT;
+    snprintf(sortie->prefixe, sizeof(sortie->prefixe), "%s", arg + 8);
+    char *deuxPoints = strrchr(sortie->prefixe, ':');
+    if (deuxPoints != NULL) {
+      char *fin;
+      long n = strtol(deuxPoints + 1, &fin, 10);
+      if (*fin != '\0' || n < 1)
+        return -1;
+      *deuxPoints = '\0';
+      sortie->periode = (uint32_t)n;
+    }
+    return 0;
+  }
+  return -1;
+}
+
+// Profondeurs que le compositeur sait produire, avec la disposition des
+// canaux attendue (conversionPixels.h)
+static int profondeurConnue(const struct fb_var_screeninfo *vinfo) {
+  switch (vinfo->bits_per_pixel) {
+  case 16:
+    return vinfo->red.offset == 11 && vinfo->green.length == 6 &&
+           vinfo->blue.offset == 0;
+  case 24:
+    return 1;
+  case 32:
+    return vinfo->red.offset == 16 && vinfo->green.offset == 8 &&
+           vinfo->blue.offset == 0;
+  default:
+    return 0;
+  }
+}
+
+static int ouvrirFramebuffer(struct sortieAffichage *sortie, uint32_t largeur,
+                             uint32_t hauteur, uint32_t bitsParPixel) {
+  sortie->fd = open("/dev/fb0", O_RDWR);
+  if (sortie->fd == -1) {
+    perror("Erreur lors de l'ouverture du framebuffer ");
+    return -1;
+  }
+
+  struct fb_var_screeninfo *vinfo = &sortie->vinfo;
+  struct fb_fix_screeninfo finfo;
+  if (ioctl(sortie->fd, FBIOGET_VSCREENINFO, vinfo)) {
+    perror("Erreur lors de la requete d'informations sur le framebuffer ");
+  }
+  memcpy(&sortie->vinfoOrig, vinfo, sizeof(struct fb_var_screeninfo));
+
+  if (bitsParPixel != 0)
+    vinfo->bits_per_pixel = bitsParPixel;
+  else if (!profondeurConnue(vinfo))
+    vinfo->bits_per_pixel = 24;
+  if (largeur > 0 && hauteur > 0) {
+    vinfo->xres = largeur;
+    vinfo->yres = hauteur;
+  }
+  vinfo->xres_virtual = vinfo->xres;
+  vinfo->yres_virtual = vinfo->yres * 2;
+  if (ioctl(sortie->fd, FBIOPUT_VSCREENINFO, vinfo)) {
+    perror("Erreur lors de l'appel a ioctl ");
+  }
+
+  if (ioctl(sortie->fd, FBIOGET_FSCREENINFO, &finfo)) {
+    perror("Erreur lors de l'appel a ioctl (2) ");
+  }
+
+  // Le pilote peut refuser la profondeur demandée : on relit celle obtenue
+  if (ioctl(sortie->fd, FBIOGET_VSCREENINFO, vinfo)) {
+    perror("Erreur lors de la requete d'informations sur le framebuffer ");
+  }
+  if (!profondeurConnue(vinfo)) {
+    fprintf(stderr, "[compositeur] Format de pixels du framebuffer non "
+                    "supporte (%u bits par pixel)\n",
+            vinfo->bits_per_pixel);
+    return -1;
+  }
+
+  sortie->largeur = vinfo->xres;
+  sortie->hauteur = vinfo->yres;
+  sortie->octetsPixel = vinfo->bits_per_pixel / 8;
+  sortie->longueurLigne = finfo.line_length;
+  sortie->tailleMap = (size_t)finfo.line_length * vinfo->yres * 2;
+  if (finfo.smem_len > 0)
+    sortie->tailleMap = finfo.smem_len;
+  void *fbp = mmap(0, sortie->tailleMap, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   sortie->fd, 0);
+  if (fbp == MAP_FAILED) {
+    perror("Erreur lors du mmap de l'affichage ");
+    return -1;
+  }
+  sortie->pages = (unsigned char *)fbp;
+  return 0;
+}
+
+/* -------------------------------------------------------------------------- *
+ *  ouvrirSortie
+ * -------------------------------------------------------------------------- */
+int ouvrirSortie(struct sortieAffichage *sortie, uint32_t largeur,
+                 uint32_t hauteur, uint32_t bitsParPixel) {
+  if (bitsParPixel != 0 && bitsParPixel != 16 && bitsParPixel != 24 &&
+      bitsParPixel != 32) {
+    fprintf(stderr, "[compositeur] Profondeur %u non supportee (16, 24, 32)\n",
+            bitsParPixel);
+    return -1;
+  }
+
+  if (sortie->type == SORTIE_FB) {
+    if (ouvrirFramebuffer(sortie, largeur, hauteur, bitsParPixel) != 0)
+      return -1;
+  } else {
+    sortie->largeur = largeur;
+    sortie->hauteur = hauteur;
+    sortie->octetsPixel = (bitsParPixel != 0) ? bitsParPixel / 8 : 3;
+    sortie->longueurLigne = largeur * sortie->octetsPixel;
+    sortie->pages =
+        (unsigned char *)malloc((size_t)sortie->longueurLigne * hauteur * 2);
+    if (sortie->pages == NULL) {
+      fprintf(stderr, "[compositeur] Erreur d'allocation des pages\n");
+      return -1;
+    }
+  }
+
+  // Les deux pages partent du même fond noir (tuile vide avec 3 flux)
+  memset(sortie->pages, 0, (size_t)sortie->longueurLigne * sortie->hauteur * 2);
+  sortie->page = 0;
+  return 0;
+}
+
+unsigned char *pageCachee(const struct sortieAffichage *sortie) {
+  return sortie->pages +
+         (size_t)(1 - sortie->page) * sortie->longueurLigne * sortie->hauteur;
+}
+
+unsigned char *pageAffichee(const struct sortieAffichage *sortie) {
+  return sortie->pages +
+         (size_t)sortie->page * sortie->longueurLigne * sortie->hauteur;
+}
+
+// Enregistre la page affichée en PPM binaire
+static void enregistrerPage(const struct sortieAffichage *sortie) {
+  char nom[300];
+  snprintf(nom, sizeof(nom), "%s-%06llu.ppm", sortie->prefixe,
+           (unsigned long long)sortie->nbPresentees);
+  FILE *f = fopen(nom, "wb");
+  if (f == NULL) {
+    perror("[compositeur] fopen");
+    return;
+  }
+  fprintf(f, "P6\n%u %u\n255\n", sortie->largeur, sortie->hauteur);
+  const unsigned char *page = pageAffichee(sortie);
+  unsigned char *rgb = (unsigned char *)malloc((size_t)sortie->largeur * 3);
+  if (rgb == NULL) {
+    fclose(f);
+    return;
+  }
+  for (uint32_t i = 0; i < sortie->hauteur; i++) {
+    convertirLigneVersRGB(page + (size_t)i * sortie->longueurLigne, rgb,
+                          sortie->largeur, sortie->octetsPixel);
+    fwrite(rgb, 1, (size_t)sortie->largeur * 3, f);
+  }
+  free(rgb);
+  fclose(f);
+}
+
+/* -------------------------------------------------------------------------- *
+ *  presenterPage
+ * -------------------------------------------------------------------------- */
+void presenterPage(struct sortieAffichage *sortie) {
+  sortie->page = 1 - sortie->page;
+
+  if (sortie->type == SORTIE_FB) {
+    sortie->vinfo.yoffset = sortie->page * sortie->vinfo.yres;
+    sortie->vinfo.activate = FB_ACTIVATE_VBL;
+    ioctl(sortie->fd, FBIOPAN_DISPLAY, &sortie->vinfo);
+  } else if (sortie->type == SORTIE_FICHIER &&
+             sortie->nbPresentees % sortie->periode == 0) {
+    enregistrerPage(sortie);
+  }
+  sortie->nbPresentees++;
+}
+
+// Période de rafraîchissement du mode vidéo, en nanosecondes, ou 0 si le
+// pilote ne fournit pas sa synchronisation (pixclock en picosecondes)
+static long periodeModeVideo(const struct fb_var_screeninfo *vinfo) {
+  uint64_t totalH = (uint64_t)vinfo->left_margin + vinfo->xres +
+                    vinfo->right_margin + vinfo->hsync_len;
+  uint64_t totalV = (uint64_t)vinfo->upper_margin + vinfo->yres +
+                    vinfo->lower_margin + vinfo->vsync_len;
+  if (vinfo->pixclock == 0 || totalH == 0 || totalV == 0)
+    return 0;
+  uint64_t periode = (uint64_t)vinfo->pixclock * totalH * totalV / 1000;
+  // Hors de 20-240 Hz, la synchronisation annoncée n'est pas crédible
+  if (periode < 1000000000ULL / 240 || periode > 1000000000ULL / 20)
+    return 0;
+  return (long)periode;
+}
+
+/* -------------------------------------------------------------------------- *
+ *  initRafraichissement
+ * -------------------------------------------------------------------------- */
+double initRafraichissement(struct sortieAffichage *sortie) {
+  sortie->vsyncMateriel = 0;
+  sortie->periodeRafraichissement = 1000000000L / SORTIE_FREQUENCE_DEFAUT;
+  sortie->rafraichissementsManques = 0;
+  sortie->dernierVsync.tv_sec = 0;
+  sortie->dernierVsync.tv_nsec = 0;
+
+  if (sortie->type == SORTIE_FB) {
+    long periode = periodeModeVideo(&sortie->vinfo);
+    if (periode > 0)
+      sortie->periodeRafraichissement = periode;
+    uint32_t ecran = 0;
+    if (ioctl(sortie->fd, FBIO_WAITFORVSYNC, &ecran) == 0)
+      sortie->vsyncMateriel = 1;
+    else if (errno != ENOTTY && errno != EINVAL)
+      perror("[compositeur] FBIO_WAITFORVSYNC ");
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &sortie->prochainRafraichissement);
+  return 1e9 / (double)sortie->periodeRafraichissement;
+}
+
+/* -------------------------------------------------------------------------- *
+ *  attendreRafraichissement
+ * -------------------------------------------------------------------------- */
+void attendreRafraichissement(struct sortieAffichage *sortie) {
+  if (sortie->vsyncMateriel) {
+    uint32_t ecran = 0;
+    if (ioctl(sortie->fd, FBIO_WAITFORVSYNC, &ecran) == 0) {
+      // Le pilote ne dit pas combien de retours verticaux ont eu lieu depuis
+      // le dernier appel : on le déduit du temps écoulé
+      struct timespec maintenant;
+      clock_gettime(CLOCK_MONOTONIC, &maintenant);
+      if (sortie->dernierVsync.tv_sec != 0 || sortie->dernierVsync.tv_nsec != 0) {
+        long long ecoule =
+            (long long)(maintenant.tv_sec - sortie->dernierVsync.tv_sec) *
+                1000000000LL +
+            (maintenant.tv_nsec - sortie->dernierVsync.tv_nsec);
+        long long periodes = (ecoule + sortie->periodeRafraichissement / 2) /
+                             sortie->periodeRafraichissement;
+        if (periodes > 1)
+          sortie->rafraichissementsManques += (uint64_t)(periodes - 1);
+      }
+      sortie->dernierVsync = maintenant;
+      return;
+    }
+    // Le pilote a cessé de répondre : on continue avec la minuterie
+    sortie->vsyncMateriel = 0;
+    clock_gettime(CLOCK_MONOTONIC, &sortie->prochainRafraichissement);
+  }
+
+  struct timespec *t = &sortie->prochainRafraichissement;
+  struct timespec maintenant;
+  clock_gettime(CLOCK_MONOTONIC, &maintenant);
+  long long retard = (long long)(maintenant.tv_sec - t->tv_sec) * 1000000000LL +
+                     (maintenant.tv_nsec - t->tv_nsec);
+  long long periodes = 0;
+  if (retard >= 0) {
+    // Échéance dépassée : on se recale sur la prochaine période à venir
+    periodes = retard / sortie->periodeRafraichissement + 1;
+    if (periodes > 1)
+      sortie->rafraichissementsManques += (uint64_t)(periodes - 1);
+  }
+  long long ns = (long long)t->tv_nsec + periodes * sortie->periodeRafraichissement;
+  t->tv_sec += (time_t)(ns / 1000000000LL);
+  t->tv_nsec = (long)(ns % 1000000000LL);
+
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, t, NULL) == EINTR)
+    ;
+}
+
+/* -------------------------------------------------------------------------- *
+ *  fermerSortie
+ * -------------------------------------------------------------------------- */
+void fermerSortie(struct sortieAffichage *sortie) {
+  if (sortie->type == SORTIE_FB) {
+    munmap(sortie->pages, sortie->tailleMap);
+    if (ioctl(sortie->fd, FBIOPUT_VSCREENINFO, &sortie->vinfoOrig)) {
+      printf("Error re-setting variable information.\n");
+    }
+    close(sortie->fd);
+  } else {
+    free(sortie->pages);
+  }
+  sortie->pages = NULL;
+}
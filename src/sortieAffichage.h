@@ -0,0 +1,127 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier de déclaration des sorties d'affichage du compositeur
+ ******************************************************************************/
+
+#ifndef SORTIE_AFFICHAGE_H
+#define SORTIE_AFFICHAGE_H
+
+// Permet de protéger le header lorsqu'il est inclus par un fichier C++
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <linux/fb.h>
+
+/******************************************************************************
+ * Le compositeur dessine toujours dans deux pages consécutives (double
+ * tampon) : il écrit dans la page cachée, puis presenterPage() l'affiche. Les
+ * pixels sont au format natif de la sortie (voir conversionPixels.h) : 16
+ * (RGB565), 24 (BGR24) ou 32 (XRGB8888) bits par pixel. Le framebuffer garde
+ * sa profondeur actuelle si elle est l'une de celles-là, sinon il est mis en
+ * 24 bits; l'option -P du compositeur impose une profondeur. La
+ * sortie détermine où se trouvent ces pages et ce que veut dire « afficher » :
+ * SORTIE_FB      : /dev/fb0, pages dans le framebuffer, affichage par
+ *                  FBIOPAN_DISPLAY (défaut)
+ * SORTIE_NULLE   : pages en mémoire, aucun affichage. Tout le travail de
+ *                  composition est fait, ce qui permet de mesurer le
+ *                  compositeur sans écran (serveur, conteneur, tests longs).
+ * SORTIE_FICHIER : comme SORTIE_NULLE, mais une page affichée sur N est
+ *                  enregistrée en PPM (prefixe-000123.ppm). L'écriture du
+ *                  fichier se fait dans la boucle d'affichage : N doit rester
+ *                  assez grand pour ne pas fausser la cadence.
+ * Option -o du compositeur : fb, null ou fichier:prefixe[:N].
+ *
+ * RAFRAÎCHISSEMENT
+ * attendreRafraichissement() bloque jusqu'au prochain retour vertical
+ * (vblank) : FBIO_WAITFORVSYNC si le pilote du framebuffer le supporte, sinon
+ * une minuterie absolue (CLOCK_MONOTONIC) à la période de rafraîchissement.
+ * Cette période est calculée à partir de la synchronisation du mode vidéo
+ * (pixclock et marges) quand le pilote la fournit, sinon elle vaut
+ * 1 / SORTIE_FREQUENCE_DEFAUT (aussi pour les sorties nulle et fichier).
+ ******************************************************************************/
+
+#define SORTIE_FB 0
+#define SORTIE_NULLE 1
+#define SORTIE_FICHIER 2
+
+#define SORTIE_PERIODE_FICHIER_DEFAUT 30
+#define SORTIE_FREQUENCE_DEFAUT 60
+
+    struct sortieAffichage
+    {
+        int type;                 // SORTIE_*
+        unsigned char *pages;     // Deux pages consécutives de hauteur lignes
+        uint32_t largeur;         // Résolution visible, en pixels
+        uint32_t hauteur;
+        uint32_t octetsPixel;     // 2 (RGB565), 3 (BGR24) ou 4 (XRGB8888)
+        uint32_t longueurLigne;   // Octets par ligne (peut dépasser largeur * octetsPixel)
+        int page;                 // Page affichée (0 ou 1)
+
+        // SORTIE_FB
+        int fd;
+        size_t tailleMap;
+        struct fb_var_screeninfo vinfo;
+        struct fb_var_screeninfo vinfoOrig;
+
+        // SORTIE_FICHIER
+        char prefixe[256];
+        uint32_t periode;         // Une page enregistrée sur periode
+        uint64_t nbPresentees;
+
+        // Rafraîchissement (voir RAFRAÎCHISSEMENT)
+        int vsyncMateriel;                        // FBIO_WAITFORVSYNC disponible
+        long periodeRafraichissement;             // En nanosecondes
+        struct timespec prochainRafraichissement; // Minuterie logicielle
+        struct timespec dernierVsync;             // Vsync matériel : dernier retour (0 : aucun)
+        uint64_t rafraichissementsManques;        // Périodes sautées (cumulatif)
+    };
+
+    // Interprète l'argument de l'option -o (fb, null, fichier:prefixe[:N]) et remplit le
+    // type de la sortie. Retourne 0 en cas de succès, -1 si l'argument n'est pas reconnu.
+    int parseSortie(const char *arg, struct sortieAffichage *sortie);
+
+    // Prépare les deux pages pour une résolution de largeur x hauteur (le framebuffer peut
+    // imposer une résolution différente : voir sortie->largeur et sortie->hauteur au retour).
+    // Avec une largeur ou une hauteur nulle, SORTIE_FB garde la résolution actuelle.
+    // bitsParPixel vaut 16, 24 ou 32, ou 0 pour la profondeur native (24 hors framebuffer).
+    // Les deux pages sont initialisées en noir. Retourne 0 en cas de succès, -1 sinon.
+    int ouvrirSortie(struct sortieAffichage *sortie, uint32_t largeur, uint32_t hauteur,
+                     uint32_t bitsParPixel);
+
+    // Page dans laquelle dessiner la prochaine image
+    unsigned char *pageCachee(const struct sortieAffichage *sortie);
+
+    // Page actuellement affichée
+    unsigned char *pageAffichee(const struct sortieAffichage *sortie);
+
+    // Affiche la page cachée (qui devient la page affichée)
+    void presenterPage(struct sortieAffichage *sortie);
+
+    // Prépare l'attente du rafraîchissement (voir RAFRAÎCHISSEMENT) et retourne la
+    // fréquence retenue, en Hz. À appeler après ouvrirSortie.
+    double initRafraichissement(struct sortieAffichage *sortie);
+
+    // Bloque jusqu'au prochain rafraîchissement de l'écran. Si une ou plusieurs
+    // périodes sont déjà passées, la minuterie logicielle les saute (et les compte
+    // dans rafraichissementsManques) plutôt que de les rattraper. Avec le vsync
+    // matériel, les périodes écoulées en trop entre deux retours sont comptées de
+    // la même façon.
+    void attendreRafraichissement(struct sortieAffichage *sortie);
+
+    // Libère les pages et restaure le mode du framebuffer
+    void fermerSortie(struct sortieAffichage *sortie);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
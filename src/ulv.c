@@ -0,0 +1,133 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier implémentant la lecture et l'indexation des fichiers ULV
+ ******************************************************************************/
+
+#include "ulv.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint32_t lireU32(const unsigned char *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(uint32_t));
+  return v;
+}
+
+// Parcourt la chaîne d'images. Si positions est NULL, ne fait que compter.
+// Retourne le nombre d'images, ou -1 si la chaîne dépasse la fin du fichier.
+static long parcourirTrames(const struct fichierULV *f, uint32_t *positions,
+                            uint32_t *tailles) {
+  size_t pos = ULV_TAILLE_ENTETE;
+  long n = 0;
+  while (1) {
+    if (pos + 4 > f->taille)
+      return -1;
+    uint32_t t = lireU32(f->donnees + pos);
+    pos += 4;
+    if (t == 0)
+      return n;
+    if (t > f->taille - pos)
+      return -1;
+    if (positions != NULL) {
+      positions[n] = (uint32_t)pos;
+      tailles[n] = t;
+    }
+    pos += t;
+    n++;
+  }
+}
+
+/* -------------------------------------------------------------------------- *
+ *  ouvrirULV
+ * -------------------------------------------------------------------------- */
+int ouvrirULV(const char *chemin, struct fichierULV *f) {
+  memset(f, 0, sizeof(*f));
+
+  int fd = open(chemin, O_RDONLY);
+  if (fd < 0) {
+    perror("ouvrirULV: open");
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    perror("ouvrirULV: fstat");
+    close(fd);
+    return -1;
+  }
+  f->taille = (size_t)st.st_size;
+
+  if (f->taille < ULV_TAILLE_ENTETE + 4) {
+    fprintf(stderr, "ouvrirULV: fichier %s trop court\n", chemin);
+    close(fd);
+    return -1;
+  }
+
+  void *ptr = mmap(NULL, f->taille, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  close(fd); // fd peut être fermé après mmap
+  if (ptr == MAP_FAILED) {
+    perror("ouvrirULV: mmap");
+    return -1;
+  }
+  f->donnees = (const unsigned char *)ptr;
+
+  if (memcmp(f->donnees, "SETR", 4) != 0) {
+    fprintf(stderr, "ouvrirULV: fichier %s invalide (mauvais magic)\n", chemin);
+    fermerULV(f);
+    return -1;
+  }
+  f->largeur = lireU32(f->donnees + 4);
+  f->hauteur = lireU32(f->donnees + 8);
+  f->canaux = lireU32(f->donnees + 12);
+  f->fps = lireU32(f->donnees + 16);
+
+  long n = parcourirTrames(f, NULL, NULL);
+  if (n <= 0) {
+    fprintf(stderr, "ouvrirULV: fichier %s %s\n", chemin,
+            (n == 0) ? "sans images" : "tronqué");
+    fermerULV(f);
+    return -1;
+  }
+
+  f->nbTrames = (uint32_t)n;
+  f->positions = (uint32_t *)malloc((size_t)n * sizeof(uint32_t));
+  f->tailles = (uint32_t *)malloc((size_t)n * sizeof(uint32_t));
+  if (f->positions == NULL || f->tailles == NULL) {
+    fprintf(stderr, "ouvrirULV: erreur d'allocation de l'index\n");
+    fermerULV(f);
+    return -1;
+  }
+  parcourirTrames(f, f->positions, f->tailles);
+  return 0;
+}
+
+void fermerULV(struct fichierULV *f) {
+  free(f->positions);
+  free(f->tailles);
+  if (f->donnees != NULL)
+    munmap((void *)f->donnees, f->taille);
+  memset(f, 0, sizeof(*f));
+}
+
+const unsigned char *trameULV(const struct fichierULV *f, uint64_t k,
+                              uint32_t *taille) {
+  uint32_t i = (uint32_t)(k % f->nbTrames);
+  *taille = f->tailles[i];
+  return f->donnees + f->positions[i];
+}
+
+uint32_t trameULVAuTemps(const struct fichierULV *f, double secondes) {
+  if (secondes <= 0.0 || f->fps == 0)
+    return 0;
+  return (uint32_t)((uint64_t)(secondes * f->fps) % f->nbTrames);
+}
@@ -0,0 +1,65 @@
+/******************************************************************************
+ * Laboratoire 3
+ * GIF-3004 Systèmes embarqués temps réel
+ * Hiver 2026
+ * Marc-André Gardner
+ *
+ * Fichier de déclaration des fonctions de lecture des fichiers ULV
+ ******************************************************************************/
+
+#ifndef ULV_H
+#define ULV_H
+
+// Permet de protéger le header lorsqu'il est inclus par un fichier C++
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/******************************************************************************
+ * Un fichier ULV est une suite d'enregistrements « uint32 taille + JPEG »
+ * (voir decodeur.c pour le format complet). Pour accéder directement à
+ * l'image k sans parcourir toutes les précédentes, ouvrirULV() parcourt la
+ * chaîne une seule fois et construit un index (position et taille de chaque
+ * image). Le parcours valide aussi les tailles : un fichier tronqué est
+ * refusé à l'ouverture plutôt que de faire lire hors du fichier plus tard.
+ ******************************************************************************/
+
+#define ULV_TAILLE_ENTETE 20
+
+    struct fichierULV
+    {
+        const unsigned char *donnees; // Fichier complet (mmap)
+        size_t taille;                // Taille du fichier, en octets
+        uint32_t largeur;
+        uint32_t hauteur;
+        uint32_t canaux;
+        uint32_t fps;
+        uint32_t nbTrames;            // Nombre d'images dans le fichier
+        uint32_t *positions;          // Position (dans donnees) du JPEG de chaque image
+        uint32_t *tailles;            // Taille du JPEG de chaque image
+    };
+
+    // Mappe le fichier en mémoire, valide son en-tête et construit l'index des images.
+    // Retourne 0 en cas de succès, -1 en cas d'erreur (message sur stderr).
+    int ouvrirULV(const char *chemin, struct fichierULV *fichier);
+
+    // Libère l'index et le mapping du fichier
+    void fermerULV(struct fichierULV *fichier);
+
+    // Retourne un pointeur vers le JPEG de l'image k (modulo le nombre d'images, de
+    // sorte que la lecture en boucle revient simplement à k = 0) et sa taille.
+    const unsigned char *trameULV(const struct fichierULV *fichier, uint64_t k,
+                                  uint32_t *taille);
+
+    // Retourne le numéro de l'image affichée au temps (en secondes) donné
+    uint32_t trameULVAuTemps(const struct fichierULV *fichier, double secondes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
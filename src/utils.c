@@ -11,6 +11,9 @@
 // supplémentaires permettant, entre autres, l'accès à sched_setattr
 #define _GNU_SOURCE
 #include "utils.h"
+#include "commMemoirePartagee.h"
+#include "histogramme.h"
+#include <limits.h>
 #include <sys/syscall.h>
 
 #define min(a, b) (((a) < (b)) ? (a) : (b))
@@ -19,6 +22,21 @@
 // Applique les paramètres d'ordonnancement au processus courant
 int appliquerOrdonnancement(const struct SchedParams *params,
                             const char *nomProgramme) {
+  if (params->masqueCpu != 0) {
+    cpu_set_t coeurs;
+    CPU_ZERO(&coeurs);
+    for (int i = 0; i < 64; i++) {
+      if (params->masqueCpu & (1ULL << i))
+        CPU_SET(i, &coeurs);
+    }
+    // 0 : le fil appelant (chaque fil d'exécution applique ses paramètres)
+    if (sched_setaffinity(0, sizeof(coeurs), &coeurs) != 0) {
+      fprintf(stderr, "[%s] Erreur sched_setaffinity: %s\n", nomProgramme,
+              strerror(errno));
+      return -1;
+    }
+  }
+
   if (params->modeOrdonnanceur == ORDONNANCEMENT_NORT)
     return 0;
 
@@ -29,7 +47,8 @@ int appliquerOrdonnancement(const struct SchedParams *params,
     attr.size = sizeof(attr);
     attr.sched_policy =
         (params->modeOrdonnanceur == ORDONNANCEMENT_RR) ? SCHED_RR : SCHED_FIFO;
-    attr.sched_priority = 99;
+    attr.sched_priority = (params->priorite > 0) ? params->priorite
+                                                 : ORDONNANCEMENT_PRIORITE_DEFAUT;
 
     if (syscall(SYS_sched_setattr, 0, &attr, 0) != 0) {
       fprintf(stderr, "[%s] Erreur sched_setattr (%s): %s\n", nomProgramme,
@@ -40,6 +59,10 @@ int appliquerOrdonnancement(const struct SchedParams *params,
   }
 
   if (params->modeOrdonnanceur == ORDONNANCEMENT_DEADLINE) {
+    // -d auto : la calibration appliquera les paramètres mesurés
+    if (params->calibration > 0)
+      return 0;
+
     struct sched_attr attr;
     memset(&attr, 0, sizeof(attr));
     attr.size = sizeof(attr);
@@ -61,13 +84,31 @@ int appliquerOrdonnancement(const struct SchedParams *params,
   return -1;
 }
 
-// Parse l'option -s (type d'ordonnanceur: NORT, RR, FIFO, DEADLINE)
+void partagerRuntime(struct SchedParams *params, int nbFils,
+                     const char *nomProgramme) {
+  if (params->modeOrdonnanceur != ORDONNANCEMENT_DEADLINE ||
+      params->calibration != 0 || nbFils <= 0)
+    return;
+  unsigned int part = params->runtime / (unsigned int)(nbFils + 1);
+  params->runtime = (part > 0) ? part : 1;
+  printf("[%s] SCHED_DEADLINE : runtime de %u ms par fil (%d fils et le fil "
+         "principal)\n",
+         nomProgramme, params->runtime, nbFils);
+}
+
+// Parse l'option -s (type d'ordonnanceur: NORT, RR, FIFO, DEADLINE, avec une
+// priorité optionnelle pour RR et FIFO : RR:50)
 int parseSchedOption(const char *arg, struct SchedParams *params) {
+  params->priorite = 0;
+  const char *deuxPoints = strchr(arg, ':');
+  size_t longueur =
+      (deuxPoints != NULL) ? (size_t)(deuxPoints - arg) : strlen(arg);
+
   if (strcmp(arg, "NORT") == 0) {
     params->modeOrdonnanceur = ORDONNANCEMENT_NORT;
-  } else if (strcmp(arg, "RR") == 0) {
+  } else if (longueur == 2 && strncmp(arg, "RR", 2) == 0) {
     params->modeOrdonnanceur = ORDONNANCEMENT_RR;
-  } else if (strcmp(arg, "FIFO") == 0) {
+  } else if (longueur == 4 && strncmp(arg, "FIFO", 4) == 0) {
     params->modeOrdonnanceur = ORDONNANCEMENT_FIFO;
   } else if (strcmp(arg, "DEADLINE") == 0) {
     params->modeOrdonnanceur = ORDONNANCEMENT_DEADLINE;
@@ -76,12 +117,45 @@ int parseSchedOption(const char *arg, struct SchedParams *params) {
     printf("Mode d'ordonnancement %s non valide, defaut sur NORT\n", arg);
     return -1;
   }
+
+  // RR:prio, FIFO:prio
+  if (deuxPoints != NULL) {
+    char *fin;
+    long prio = strtol(deuxPoints + 1, &fin, 10);
+    if (*fin != '\0' || prio < 1 || prio > 99) {
+      printf("Priorite %s non valide (1 a 99), defaut sur %d\n",
+             deuxPoints + 1, ORDONNANCEMENT_PRIORITE_DEFAUT);
+      return -1;
+    }
+    params->priorite = (unsigned int)prio;
+  }
   return 0;
 }
 
 // Parse l'argument suivant l'option -d (runtime,deadline,period en
-// millisecondes)
+// millisecondes, ou auto[:N])
 int parseDeadlineParams(char *arg, struct SchedParams *params) {
+  if (strcmp(arg, "auto") == 0) {
+    params->calibration = CALIBRATION_NB_PERIODES_DEFAUT;
+    return 0;
+  }
+  if (strncmp(arg, "auto", 4) == 0) {
+    // Seuls auto et auto:N (N > 0) sont acceptés
+    char *fin = arg + 4;
+    long nbPeriodes = 0;
+    if (arg[4] == ':')
+      nbPeriodes = strtol(arg + 5, &fin, 10);
+    if (arg[4] != ':' || fin == arg + 5 || *fin != '\0' || nbPeriodes < 1 ||
+        (unsigned long)nbPeriodes > UINT_MAX) {
+      fprintf(stderr, "Option -d %s non valide : auto ou auto:N (N > 0)\n",
+              arg);
+      exit(EXIT_FAILURE);
+    }
+    params->calibration = (unsigned int)nbPeriodes;
+    return 0;
+  }
+  params->calibration = 0;
+
   int paramIndex = 0;
   char *splitString = strtok(arg, ",");
   while (splitString != NULL) {
@@ -100,6 +174,72 @@ int parseDeadlineParams(char *arg, struct SchedParams *params) {
   return 0;
 }
 
+// Parse l'argument suivant l'option -c (liste de coeurs : 2, 0-1, 0,2-3)
+int parseCpuset(const char *arg, struct SchedParams *params) {
+  uint64_t masque = 0;
+  const char *p = arg;
+  while (*p != '\0') {
+    char *fin;
+    long debut = strtol(p, &fin, 10);
+    long dernier = debut;
+    if (fin == p)
+      break;
+    if (*fin == '-') {
+      p = fin + 1;
+      dernier = strtol(p, &fin, 10);
+      if (fin == p)
+        break;
+    }
+    if (debut < 0 || dernier < debut || dernier > 63)
+      break;
+    for (long i = debut; i <= dernier; i++)
+      masque |= 1ULL << i;
+    p = fin;
+    if (*p == ',')
+      p++;
+    else if (*p != '\0')
+      break;
+  }
+  if (*p != '\0' || masque == 0) {
+    printf("Liste de coeurs %s non valide (ex. 2, 0-1, 0,2-3), aucune "
+           "affinite imposee\n",
+           arg);
+    params->masqueCpu = 0;
+    return -1;
+  }
+  params->masqueCpu = masque;
+  return 0;
+}
+
+// Traite une des options communes à tous les programmes (voir utils.h)
+int parseOptionCommune(int option, char *arg, struct SchedParams *params) {
+  switch (option) {
+  case 's':
+    parseSchedOption(arg, params);
+    return 1;
+  case 'd':
+    parseDeadlineParams(arg, params);
+    return 1;
+  case 'm':
+    parseModeSync(arg);
+    return 1;
+  case 'b':
+    parseAttenteActive(arg);
+    return 1;
+  case 'p':
+    parsePolitique(arg);
+    return 1;
+  case 'n':
+    parseNbLecteurs(arg);
+    return 1;
+  case 'c':
+    parseCpuset(arg, params);
+    return 1;
+  default:
+    return 0;
+  }
+}
+
 /* Convolution with repeat mode */
 void _convolve(const unsigned int height, const unsigned int width,
                const float *input, const Kernel kern, float *output) {
@@ -124,8 +264,9 @@ void _convolve(const unsigned int height, const unsigned int width,
       // Iterate over elements of kernel
       for (i = -kh2; i <= kh2; i++) {
         for (j = -kw2; j <= kw2; j++) {
-          data = input[min(max(y + i, 0), height - 1) * iw +
-                       min(max(j + x, 0), width - 1)];
+          // En int : y + i en non signé ferait lire le bord opposé
+          data = input[min(max((int)y + i, 0), (int)height - 1) * iw +
+                       min(max(j + (int)x, 0), (int)width - 1)];
           coeff = kern.data[(i + kh2) * kw + (j + kw2)];
           sum += data * coeff;
         }
@@ -530,6 +671,87 @@ void convertToGray(const unsigned char *input, const unsigned int in_height,
   }
 }
 
+// Coefficients YCbCr « pleine échelle » de JPEG (JFIF, ITU-R BT.601), en point
+// fixe sur 8 bits comme dans convertToGray (avec arrondi, pour qu'un aller-retour
+// BGR -> YUV -> BGR ne biaise pas les couleurs)
+static inline unsigned char _clampOctet(int v) {
+  return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+void convertToYUV420(const unsigned char *input, const unsigned int in_height,
+                     const unsigned int in_width, const unsigned int format,
+                     unsigned char *output) {
+  struct planImage plans[PLANS_MAX];
+  plansImage(format, in_width, in_height, plans);
+  unsigned char *y = output;
+  unsigned char *u = output + plans[1].decalage;
+  unsigned char *v = (format == FORMAT_NV12) ? u + 1 : output + plans[2].decalage;
+  const unsigned int pas = (format == FORMAT_NV12) ? 2 : 1;
+
+  for (unsigned int idx = 0; idx < in_height * in_width; ++idx) {
+    const unsigned char *src = input + idx * 3;
+    y[idx] =
+        (unsigned char)((29 * src[0] + 150 * src[1] + 77 * src[2] + 128) >> 8);
+  }
+
+  // Cb = (128*B - 85*G - 43*R) >> 8, Cr = (-21*B - 107*G + 128*R) >> 8, sur la
+  // moyenne BGR de chaque bloc 2x2 (tronqué sur le bord droit et le bas)
+  for (unsigned int i = 0; i < plans[1].hauteur; ++i) {
+    for (unsigned int j = 0; j < plans[1].largeur; ++j) {
+      int b = 0, g = 0, r = 0, n = 0;
+      for (unsigned int di = 2 * i; di < min(2 * i + 2, in_height); ++di) {
+        for (unsigned int dj = 2 * j; dj < min(2 * j + 2, in_width); ++dj) {
+          const unsigned char *src = input + (di * in_width + dj) * 3;
+          b += src[0];
+          g += src[1];
+          r += src[2];
+          n++;
+        }
+      }
+      b = (b + n / 2) / n;
+      g = (g + n / 2) / n;
+      r = (r + n / 2) / n;
+      const unsigned int k = (i * plans[1].largeur + j) * pas;
+      u[k] = _clampOctet(((128 * b - 85 * g - 43 * r + 128) >> 8) + 128);
+      v[k] = _clampOctet(((-21 * b - 107 * g + 128 * r + 128) >> 8) + 128);
+    }
+  }
+}
+
+void convertYUV420RowToBGR(const unsigned char *input,
+                           const unsigned int in_height,
+                           const unsigned int in_width,
+                           const unsigned int format, const unsigned int row,
+                           unsigned char *output) {
+  struct planImage plans[PLANS_MAX];
+  plansImage(format, in_width, in_height, plans);
+  const unsigned char *y = input + row * in_width;
+  const unsigned char *u = input + plans[1].decalage;
+  const unsigned char *v =
+      (format == FORMAT_NV12) ? u + 1 : input + plans[2].decalage;
+  const unsigned int pas = (format == FORMAT_NV12) ? 2 : 1;
+  const unsigned int ligneC = (row / 2) * plans[1].largeur;
+
+  // B = Y + 1.772*Cb, G = Y - 0.344*Cb - 0.714*Cr, R = Y + 1.402*Cr
+  for (unsigned int j = 0; j < in_width; ++j) {
+    const unsigned int k = (ligneC + j / 2) * pas;
+    const int cb = u[k] - 128, cr = v[k] - 128;
+    const int l = y[j];
+    unsigned char *dst = output + j * 3;
+    dst[0] = _clampOctet(l + ((454 * cb + 128) >> 8));
+    dst[1] = _clampOctet(l - ((88 * cb + 183 * cr + 128) >> 8));
+    dst[2] = _clampOctet(l + ((359 * cr + 128) >> 8));
+  }
+}
+
+void convertYUV420ToBGR(const unsigned char *input, const unsigned int in_height,
+                        const unsigned int in_width, const unsigned int format,
+                        unsigned char *output) {
+  for (unsigned int i = 0; i < in_height; ++i)
+    convertYUV420RowToBGR(input, in_height, in_width, format, i,
+                          output + i * in_width * 3);
+}
+
 void enregistreImage(const unsigned char *input, const unsigned int in_height,
                      const unsigned int in_width, const unsigned int n_channels,
                      const char *nomfichier) {
@@ -545,13 +767,25 @@ void enregistreImage(const unsigned char *input, const unsigned int in_height,
   fclose(f);
 }
 
-void initProfilage(InfosProfilage *dataprof,
-                   const char *chemin_enregistrement) {
+void initProfilage(InfosProfilage *dataprof, const char *argv0) {
+  dataprof->calibration = NULL;
+  dataprof->fd = NULL;
   if (PROFILAGE_ACTIF == 0) {
     return;
   }
-  // Ouverture du fichier
-  dataprof->fd = fopen(chemin_enregistrement, "w+");
+  // Ouverture du fichier profilage-<programme>-<pid>.txt dans le répertoire
+  // courant, quel que soit le chemin par lequel le programme a été lancé
+  const char *nomProgramme = strrchr(argv0, '/');
+  nomProgramme = (nomProgramme != NULL) ? nomProgramme + 1 : argv0;
+  char chemin[128];
+  snprintf(chemin, sizeof(chemin), "profilage-%s-%u.txt", nomProgramme,
+           (unsigned int)getpid());
+  dataprof->fd = fopen(chemin, "w+");
+  if (dataprof->fd == NULL) {
+    fprintf(stderr, "[%s] Profilage désactivé : ", nomProgramme);
+    perror(chemin);
+    return;
+  }
   dataprof->derniere_sauvegarde = 0;
   dataprof->dernier_etat = ETAT_INDEFINI;
 
@@ -565,8 +799,147 @@ void initProfilage(InfosProfilage *dataprof,
   dataprof->pos = 0;
 }
 
+struct calibrationDeadline {
+  struct SchedParams *params;
+  const char *nomProgramme;
+  uint64_t periodeNs;
+  uint64_t debutFenetre; // CLOCK_MONOTONIC, en ns
+  clockid_t horloge;     // CLOCK_THREAD_CPUTIME_ID, ou du processus avec des fils
+  uint64_t cpuFenetre;   // Temps CPU au début de la fenêtre
+  struct SchedParams *paramsFils; // calibrerAvecFils, NULL sinon
+  int nbFils;
+  uint32_t nbMesures;
+  struct histogramme cpu; // Temps CPU par période, en microsecondes
+};
+
+static uint64_t tempsNs(clockid_t horloge) {
+  struct timespec t;
+  clock_gettime(horloge, &t);
+  return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+void initCalibration(InfosProfilage *dataprof, struct SchedParams *params,
+                     uint32_t fps, const char *nomProgramme) {
+  if (params->calibration != 0 &&
+      params->modeOrdonnanceur != ORDONNANCEMENT_DEADLINE)
+    fprintf(stderr, "[%s] -d auto ignoré : la calibration demande -s "
+                    "DEADLINE\n",
+            nomProgramme);
+  if (params->modeOrdonnanceur != ORDONNANCEMENT_DEADLINE ||
+      params->calibration == 0)
+    return;
+
+  struct calibrationDeadline *c =
+      (struct calibrationDeadline *)calloc(1, sizeof(*c));
+  if (c == NULL) {
+    fprintf(stderr, "[%s] Erreur d'allocation de la calibration\n",
+            nomProgramme);
+    return;
+  }
+  c->params = params;
+  c->nomProgramme = nomProgramme;
+  c->periodeNs = (fps > 0) ? 1000000000ULL / fps : 33333333ULL;
+  c->debutFenetre = tempsNs(CLOCK_MONOTONIC);
+  c->horloge = CLOCK_THREAD_CPUTIME_ID;
+  c->cpuFenetre = tempsNs(c->horloge);
+  dataprof->calibration = c;
+  printf("[%s] Calibration de SCHED_DEADLINE sur %u periodes de %.1f ms\n",
+         nomProgramme, params->calibration, c->periodeNs * 1e-6);
+}
+
+void calibrerAvecFils(InfosProfilage *dataprof, struct SchedParams *paramsFils,
+                      int nbFils) {
+  struct calibrationDeadline *c = dataprof->calibration;
+  if (c == NULL || nbFils <= 0)
+    return;
+  c->horloge = CLOCK_PROCESS_CPUTIME_ID;
+  c->cpuFenetre = tempsNs(c->horloge);
+  c->paramsFils = paramsFils;
+  c->nbFils = nbFils;
+  printf("[%s] Calibration du processus entier (%d fils et le fil principal)\n",
+         c->nomProgramme, nbFils);
+}
+
+void appliquerOrdonnancementFil(const struct SchedParams *params, int *applique,
+                                const char *nomProgramme) {
+  if (*applique)
+    return;
+  if (params->modeOrdonnanceur == ORDONNANCEMENT_DEADLINE &&
+      __atomic_load_n(&params->calibration, __ATOMIC_ACQUIRE) != 0)
+    return;
+  *applique = 1;
+  if (appliquerOrdonnancement(params, nomProgramme) != 0)
+    fprintf(stderr, "[%s] Fil d'exécution : ordonnancement refusé, le fil "
+                    "garde celui du processus\n",
+            nomProgramme);
+}
+
+// Choisit les paramètres de SCHED_DEADLINE à partir des mesures et les applique
+static void terminerCalibration(struct calibrationDeadline *c) {
+  struct SchedParams *params = c->params;
+  uint64_t percentileUs = histoPercentile(&c->cpu, CALIBRATION_PERCENTILE);
+  unsigned int periodeMs = (unsigned int)(c->periodeNs / 1000000ULL);
+  if (periodeMs == 0)
+    periodeMs = 1;
+  unsigned int runtimeMs =
+      (unsigned int)ceil(percentileUs * CALIBRATION_MARGE / 1000.0);
+  if (runtimeMs == 0)
+    runtimeMs = 1;
+  if (runtimeMs > periodeMs) {
+    fprintf(stderr,
+            "[%s] Calibration : runtime de %u ms requis pour une periode de "
+            "%u ms, la cadence ne pourra pas etre tenue\n",
+            c->nomProgramme, runtimeMs, periodeMs);
+    runtimeMs = periodeMs;
+  }
+
+  params->runtime = runtimeMs;
+  params->deadline = periodeMs;
+  params->period = periodeMs;
+  params->calibration = 0;
+  printf("[%s] Calibration : p%.0f = %.2f ms (max %.2f ms) -> -d %u,%u,%u\n",
+         c->nomProgramme, CALIBRATION_PERCENTILE, percentileUs / 1000.0,
+         c->cpu.max / 1000.0, params->runtime, params->deadline,
+         params->period);
+  if (c->paramsFils != NULL) {
+    // Les fils attendent que calibration passe à 0 pour lire les paramètres
+    partagerRuntime(params, c->nbFils, c->nomProgramme);
+    c->paramsFils->runtime = params->runtime;
+    c->paramsFils->deadline = params->deadline;
+    c->paramsFils->period = params->period;
+    __atomic_store_n(&c->paramsFils->calibration, 0, __ATOMIC_RELEASE);
+  }
+  appliquerOrdonnancement(params, c->nomProgramme);
+}
+
+// Appelée à chaque événement de profilage pendant la calibration : le temps
+// CPU consommé depuis le début de la fenêtre est noté dès qu'une période est
+// écoulée (en moyenne par période si plusieurs sont passées sans événement)
+static void mesurerCalibration(InfosProfilage *dataprof) {
+  struct calibrationDeadline *c = dataprof->calibration;
+  uint64_t maintenant = tempsNs(CLOCK_MONOTONIC);
+  uint64_t ecoule = maintenant - c->debutFenetre;
+  if (ecoule < c->periodeNs)
+    return;
+
+  uint64_t cpu = tempsNs(c->horloge);
+  uint64_t nbPeriodes = ecoule / c->periodeNs;
+  histoAjouter(&c->cpu, (cpu - c->cpuFenetre) / nbPeriodes / 1000);
+  c->debutFenetre += nbPeriodes * c->periodeNs;
+  c->cpuFenetre = cpu;
+
+  if (++c->nbMesures >= c->params->calibration) {
+    dataprof->calibration = NULL;
+    terminerCalibration(c);
+    free(c);
+  }
+}
+
 void evenementProfilage(InfosProfilage *dataprof, unsigned int type) {
-  if (PROFILAGE_ACTIF == 0) {
+  if (dataprof->calibration != NULL)
+    mesurerCalibration(dataprof);
+
+  if (PROFILAGE_ACTIF == 0 || dataprof->fd == NULL) {
     return;
   }
 
@@ -618,17 +991,8 @@ size_t parseArgs(int argc, char *argv[], struct SchedParams *params,
   }
 
   int c;
-  while ((c = getopt(argc, argv, "s:d:")) != -1) {
-    switch (c) {
-    case 's':
-      parseSchedOption(optarg, params);
-      break;
-    case 'd':
-      parseDeadlineParams(optarg, params);
-      break;
-    case '?':
-      break;
-    }
+  while ((c = getopt(argc, argv, OPTIONS_COMMUNES)) != -1) {
+    parseOptionCommune(c, optarg, params);
   }
 
   size_t index = 0;
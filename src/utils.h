@@ -37,6 +37,10 @@ extern "C"
 #define ORDONNANCEMENT_FIFO 2
 #define ORDONNANCEMENT_DEADLINE 3
 
+// Priorité utilisée en RR et FIFO lorsque -s n'en précise pas (voir planificateur.py
+// pour répartir les priorités entre les étapes d'un pipeline)
+#define ORDONNANCEMENT_PRIORITE_DEFAUT 99
+
     // Structure contenant les paramètres d'ordonnancement
     // Attention, le paramètres pour deadline sont conservés en millisecondes (tels
     // que reçus sur la ligne de commande), alors que la valeur à utiliser avec
@@ -44,32 +48,71 @@ extern "C"
     struct SchedParams
     {
         int modeOrdonnanceur;
+        unsigned int priorite; // RR et FIFO : priorité (1 à 99), 0 pour ORDONNANCEMENT_PRIORITE_DEFAUT
         unsigned int runtime;  // en millisecondes, tel que reçu sur la ligne de commande
         unsigned int deadline; // en millisecondes, tel que reçu sur la ligne de commande
         unsigned int period;   // en millisecondes, tel que reçu sur la ligne de commande
+        unsigned int calibration; // -d auto[:N] : nombre de périodes mesurées avant de passer
+                                  // en SCHED_DEADLINE (voir CALIBRATION); 0 sinon
+        uint64_t masqueCpu;       // -c : coeurs permis (bit i pour le coeur i), 0 pour tous
     };
 
-    // Parse l'argument suivant l'option -s (type d'ordonnanceur: NORT, RR, FIFO, DEADLINE)
-    // et initialise le champ modeOrdonnanceur dans la structure SchedParams.
+    // Parse l'argument suivant l'option -s (type d'ordonnanceur: NORT, RR, FIFO, DEADLINE;
+    // RR:prio et FIFO:prio pour une priorité autre que ORDONNANCEMENT_PRIORITE_DEFAUT)
+    // et initialise les champs modeOrdonnanceur et priorite dans la structure SchedParams.
     // Retourne 0 en cas de succès, -1 si le mode n'est pas reconnu (utilise NORT par défaut)
     int parseSchedOption(const char *arg, struct SchedParams *params);
 
-    // Parse l'argument suivant l'option -d (runtime,deadline,period en millisecondes)
-    // et initialise les champs correspondants dans la structure SchedParams.
+    // Parse l'argument suivant l'option -d (runtime,deadline,period en millisecondes, ou
+    // auto[:N]) et initialise les champs correspondants dans la structure SchedParams.
     int parseDeadlineParams(char *arg, struct SchedParams *params);
 
+    // Parse l'argument suivant l'option -c (liste de coeurs : 2, 0-1, 0,2-3) et initialise
+    // le champ masqueCpu. Retourne 0 en cas de succès, -1 si la liste n'est pas valide
+    // (aucune affinité n'est alors imposée).
+    int parseCpuset(const char *arg, struct SchedParams *params);
+
+// Options de ligne de commande communes à tous les programmes, à inclure dans la
+// chaîne passée à getopt :
+//   -s mode       type d'ordonnanceur (NORT, RR, FIFO, DEADLINE), RR:prio ou FIFO:prio
+//   -d r,d,p      paramètres de SCHED_DEADLINE (en millisecondes), ou auto[:N]
+//   -m mode       synchronisation des zones écrites par le programme (PTHREAD, FUTEX, FUTEX_PI)
+//   -b ns         budget maximal d'attente active avant de bloquer (0 pour désactiver)
+//   -p politique  politique des zones écrites par le programme (BLOQUANTE, DERNIERE)
+//   -n lecteurs   nombre de programmes qui liront la zone écrite par le programme
+//   -c coeurs     coeurs sur lesquels le programme peut s'exécuter (ex. 2, 0-1, 0,2-3)
+#define OPTIONS_COMMUNES "s:d:m:b:p:n:c:"
+
+    // Traite une des options décrites par OPTIONS_COMMUNES.
+    // Retourne 1 si l'option a été reconnue et traitée, 0 sinon.
+    int parseOptionCommune(int option, char *arg, struct SchedParams *params);
+
     // Applique les paramètres d'ordonnancement au processus courant
     // La chaîne de caractères nomProgramme est utilisée pour les messages d'erreur
     // Retourne 0 en cas de succès, -1 en cas d'erreur
-    // TODO : implémenter cette fonction dans utils.c
+    // Avec -s DEADLINE -d auto, ne fait rien : c'est la calibration qui appliquera
+    // SCHED_DEADLINE (voir CALIBRATION)
+    // Applique aussi l'affinité demandée avec -c, quel que soit le mode. Le noyau refuse
+    // SCHED_DEADLINE à un fil dont l'affinité ne couvre pas tous les coeurs de son
+    // domaine : avec -s DEADLINE, -c demande un cpuset exclusif (cgroup) pour ces coeurs.
     int appliquerOrdonnancement(const struct SchedParams *params, const char *nomProgramme);
 
+    // Pour un programme qui lance nbFils fils d'exécution (decodeur -j, compositeur -T).
+    // Les fils sont lancés avant appliquerOrdonnancement, car un fil SCHED_DEADLINE ne
+    // peut pas en créer d'autres, et chacun applique lui-même l'ordonnancement. Avec
+    // -s DEADLINE -d r,d,p, chaque fil obtiendrait alors sa propre réservation de r ms :
+    // le runtime est partagé entre les fils et le fil principal (r / (nbFils+1) ms
+    // chacun, au moins 1 ms), pour que la bande passante réservée reste r / p. Ne fait
+    // rien dans les autres modes, ni pendant une calibration (-d auto).
+    void partagerRuntime(struct SchedParams *params, int nbFils, const char *nomProgramme);
+
 #define ETAT_INDEFINI 0
 #define ETAT_INITIALISATION 10
 #define ETAT_ATTENTE_MUTEXLECTURE 20
 #define ETAT_TRAITEMENT 30
 #define ETAT_ATTENTE_MUTEXECRITURE 40
 #define ETAT_ENPAUSE 50
+#define ETAT_SAUT 60 // Images sautées sans être traitées (programme en retard)
 
 // Mettre a zero pour desactiver le profilage
 #define PROFILAGE_ACTIF 1
@@ -90,6 +133,8 @@ extern "C"
         float *i_f, *j_f;
     } ResizeGrid;
 
+    struct calibrationDeadline;
+
     typedef struct
     {
         char *data;
@@ -98,8 +143,47 @@ extern "C"
         uint64_t derniere_sauvegarde;
         unsigned int dernier_etat;
         FILE *fd;
+        struct calibrationDeadline *calibration; // -d auto, NULL sinon
     } InfosProfilage;
 
+/******************************************************************************
+ * CALIBRATION (-s DEADLINE -d auto[:N])
+ * Le programme démarre en NORT. À chaque appel de evenementProfilage, le temps
+ * CPU consommé par le fil principal (CLOCK_THREAD_CPUTIME_ID) est réparti en
+ * fenêtres d'une période (1 / fps du flux), ce qui mesure directement ce que
+ * SCHED_DEADLINE limite : le temps d'exécution par période, attente active et
+ * écriture comprises. Après N périodes (CALIBRATION_NB_PERIODES_DEFAUT), le
+ * programme choisit runtime = percentile CALIBRATION_PERCENTILE des mesures
+ * multiplié par CALIBRATION_MARGE (arrondi à la milliseconde supérieure, au
+ * plus la période), deadline = period = 1 / fps, puis passe lui-même en
+ * SCHED_DEADLINE avec appliquerOrdonnancement. Les paramètres retenus sont
+ * affichés, pour être réutilisés tels quels avec -d r,d,p.
+ * Avec des fils d'exécution (decodeur -j, compositeur -T, voir
+ * calibrerAvecFils), c'est le temps CPU de tout le processus
+ * (CLOCK_PROCESS_CPUTIME_ID) qui est mesuré. Le runtime affiché est le total,
+ * à réutiliser avec le même nombre de fils; il est partagé entre les fils
+ * comme celui de -d r,d,p (partagerRuntime), et chaque fil passe en
+ * SCHED_DEADLINE dans appliquerOrdonnancementFil.
+ ******************************************************************************/
+#define CALIBRATION_NB_PERIODES_DEFAUT 150
+#define CALIBRATION_PERCENTILE 99.0
+#define CALIBRATION_MARGE 1.25
+
+    // Prépare la calibration si params la demande (sinon, ne fait rien). fps est la
+    // cadence du flux traité par le programme. À appeler avant appliquerOrdonnancement.
+    void initCalibration(InfosProfilage *dataprof, struct SchedParams *params, uint32_t fps,
+                         const char *nomProgramme);
+
+    // À appeler après initCalibration par un programme qui a lancé nbFils fils
+    // d'exécution ordonnancés selon paramsFils (copie de params).
+    void calibrerAvecFils(InfosProfilage *dataprof, struct SchedParams *paramsFils, int nbFils);
+
+    // Appelée par un fil d'exécution à chaque tour de sa boucle, avec *applique à 0 au
+    // lancement du fil : applique params une seule fois, dès qu'ils sont connus (tout
+    // de suite, ou à la fin de la calibration avec -d auto).
+    void appliquerOrdonnancementFil(const struct SchedParams *params, int *applique,
+                                    const char *nomProgramme);
+
     // Les fonctions de redimensionnement requièrent une *ResizeGrid* en entrée. Celle-ci est commune à toutes les
     // images et peut être précalculée, ce qui accélère le traitement.
 
@@ -143,10 +227,29 @@ extern "C"
     void convertToGray(const unsigned char *input, const unsigned int in_height, const unsigned int in_width, const unsigned int n_channels,
                        unsigned char *output);
 
+    // Convertit une image BGR (3 canaux) en YCbCr 4:2:0 planaire (format FORMAT_I420 ou
+    // FORMAT_NV12, voir commMemoirePartagee.h). Chaque échantillon de chrominance est
+    // la moyenne d'un bloc de 2x2 pixels.
+    // Le buffer de sortie (output) DOIT être préalloué (voir tailleImageVideo).
+    void convertToYUV420(const unsigned char *input, const unsigned int in_height, const unsigned int in_width,
+                         const unsigned int format, unsigned char *output);
+
+    // Convertit une image YCbCr 4:2:0 planaire (FORMAT_I420 ou FORMAT_NV12) en BGR (3 canaux)
+    // Le buffer de sortie (output) DOIT être préalloué en considérant les dimensions de l'image.
+    void convertYUV420ToBGR(const unsigned char *input, const unsigned int in_height, const unsigned int in_width,
+                            const unsigned int format, unsigned char *output);
+
+    // Comme convertYUV420ToBGR, pour la seule ligne row de l'image (in_width pixels BGR écrits
+    // dans output). Permet de convertir directement vers la destination finale.
+    void convertYUV420RowToBGR(const unsigned char *input, const unsigned int in_height, const unsigned int in_width,
+                               const unsigned int format, const unsigned int row, unsigned char *output);
+
     // Enregistre l'image dans un fichier PPM dont le nom est passé en paramètre
     void enregistreImage(const unsigned char *input, const unsigned int in_height, const unsigned int in_width, const unsigned int n_channels, const char *nomfichier);
 
-    void initProfilage(InfosProfilage *dataprof, const char *chemin_enregistrement);
+    // Ouvre profilage-<programme>-<pid>.txt (argv0 : argv[0] du programme). Si le
+    // fichier ne peut pas être créé, le profilage est désactivé.
+    void initProfilage(InfosProfilage *dataprof, const char *argv0);
 
     void evenementProfilage(InfosProfilage *dataprof, unsigned int type);
 